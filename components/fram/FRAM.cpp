@@ -9,6 +9,8 @@
 // ESPHome port: https://github.com/sharkydog/esphome-fram
 
 #include "FRAM.h"
+#include "esphome/core/application.h"
+#include <algorithm>
 
 namespace esphome {
 namespace fram {
@@ -17,6 +19,47 @@ namespace fram {
 const uint8_t FRAM_SLAVE_ID_ = 0x7C;  //  == 0xF8
 const uint8_t FRAM_SLEEP_CMD = 0x86;  //
 static const char * const TAG = "fram";
+static const uint32_t FRAM_CACHE_EMPTY = 0xFFFFFFFF;
+
+#ifdef USE_FRAM_ASYNC
+//  worker task and loop() share the bus, cache and write buffer
+#define FRAM_LOCK() std::lock_guard<std::recursive_mutex> guard(this->_lock)
+#else
+#define FRAM_LOCK()
+#endif
+
+
+//  bus clock cycles of one transaction, 9 per byte with ACK
+//  write:  S  dev  maddr  data  P
+//  read:   S  dev  maddr  Sr  dev  data  P
+static uint32_t wireCycles(uint8_t addrlen, uint32_t size, bool read)
+{
+  uint32_t bytes = 1 + addrlen + size + (read ? 1 : 0);
+  uint32_t conditions = read ? 3 : 2;
+  return bytes * 9 + conditions;
+}
+
+
+//  word at a time search, returns index of c in p or -1
+static int32_t findByte(const uint8_t * p, uint16_t len, uint8_t c)
+{
+  const uint32_t ones = 0x01010101UL;
+  const uint32_t pattern = ones * c;
+  uint16_t i = 0;
+  for (; i + 4 <= len; i += 4)
+  {
+    uint32_t v;
+    memcpy(&v, p + i, 4);
+    v ^= pattern;
+    //  true when one of the bytes in v is 0 => equal to c
+    if ((v - ones) & ~v & (ones << 7)) break;
+  }
+  for (; i < len; i++)
+  {
+    if (p[i] == c) return i;
+  }
+  return -1;
+}
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -34,6 +77,50 @@ void FRAM::setup()
   {
     ESP_LOGW(TAG, "Device on address 0x%x returned 0 size, set size in config!", this->address_);
   }
+
+#ifdef USE_FRAM_ASYNC
+  this->_loopTask = xTaskGetCurrentTaskHandle();
+  if (this->_asyncQueueSize && !this->is_failed())
+  {
+    this->_asyncQueue = xQueueCreate(this->_asyncQueueSize, sizeof(FRAM_REQUEST *));
+    this->_asyncDone = xQueueCreate(this->_asyncQueueSize, sizeof(FRAM_REQUEST *));
+    xTaskCreatePinnedToCore(FRAM::_asyncTask, "fram", 3072, this,
+      this->_asyncPriority, nullptr, (this->_asyncCore < 0) ? tskNO_AFFINITY : this->_asyncCore);
+  }
+#endif
+}
+
+void FRAM::loop()
+{
+#ifdef USE_FRAM_ASYNC
+  //  completion callbacks run here, not in the worker task
+  FRAM_REQUEST * req;
+  while (this->_asyncDone && (xQueueReceive(this->_asyncDone, &req, 0) == pdTRUE))
+  {
+    if (req->done) req->done();
+    delete req;
+  }
+#endif
+
+  if (this->_operation.type != FRAM_OPERATION::NONE)
+  {
+    this->_operationStep();
+  }
+
+  if (this->_wbDirty && (millis() - this->_wbSince >= this->_flushInterval))
+  {
+    this->flush();
+  }
+
+  if (this->_autoSleep && !this->_asleep && !this->isBusy() &&
+    (millis() - this->_lastAccess >= this->_autoSleep))
+  {
+#ifdef USE_FRAM_ASYNC
+    //  not while the worker task has requests
+    if (this->_asyncQueue && uxQueueMessagesWaiting(this->_asyncQueue)) return;
+#endif
+    this->sleep();
+  }
 }
 
 void FRAM::dump_config()
@@ -48,240 +135,737 @@ void FRAM::dump_config()
   }
 
   if (this->_sizeBytes) {
-    ESP_LOGCONFIG(TAG, "  Size: %uKiB", this->_sizeBytes / 1024UL);
+    ESP_LOGCONFIG(TAG, "  Size: %uKiB", this->_sizeBytes / 1024);
   } else if(ok) {
     ESP_LOGW(TAG, "  Size: 0KiB, set size in config!");
   }
+
+  ESP_LOGCONFIG(TAG, "  Max transfer: %u bytes", this->_maxTransfer);
+
+  if (this->_autoSleep) {
+    ESP_LOGCONFIG(TAG, "  Auto sleep after: %ums, sleeps: %u, wakes: %u, asleep: %ums",
+      this->_autoSleep, this->_sleeps, this->_wakes, this->getSleepTime());
+  }
+
+  if (this->_cacheSets) {
+    ESP_LOGCONFIG(TAG, "  Read cache: %u lines of %u bytes, %u-way",
+      this->_cacheSets * FRAM_CACHE_WAYS, this->_cacheLineSize, FRAM_CACHE_WAYS);
+  }
+
+#ifdef USE_FRAM_ASYNC
+  if (this->_asyncQueueSize) {
+    ESP_LOGCONFIG(TAG, "  Async: queue %u, priority %u, core %d",
+      this->_asyncQueueSize, this->_asyncPriority, this->_asyncCore);
+  }
+#endif
+
+  if (!this->_wbLines.empty()) {
+    ESP_LOGCONFIG(TAG, "  Write buffer: %u bytes, flush interval: %ums",
+      (unsigned)(this->_wbLines.size() * FRAM_WB_LINE), this->_flushInterval);
+  }
+
+#ifdef USE_FRAM_STATS
+  auto & st = this->_stats;
+  ESP_LOGCONFIG(TAG, "  Reads: %u (%u bytes), writes: %u (%u bytes), errors: %u",
+    st.reads, st.bytes_read, st.writes, st.bytes_written, this->getErrors());
+
+  std::string rd, wr;
+  for (uint8_t i = 0; i < FRAM_STATS_BUCKETS; i++) {
+    rd += str_sprintf(" %u", st.read_latency[i]);
+    wr += str_sprintf(" %u", st.write_latency[i]);
+  }
+  ESP_LOGCONFIG(TAG, "  Wire time: %ums projected at %ukHz",
+    (uint32_t)((uint64_t)st.wire_cycles * 1000 / this->_busFrequency), this->_busFrequency / 1000);
+  ESP_LOGCONFIG(TAG, "  Read latency (<128us, doubling):%s", rd.c_str());
+  ESP_LOGCONFIG(TAG, "  Write latency (<128us, doubling):%s", wr.c_str());
+#endif
 }
 
 
 bool FRAM::isConnected()
 {
+  FRAM_LOCK();
+  this->_wake();
   i2c::ErrorCode err = this->bus_->write(this->address_, nullptr, 0, true);
   return (err == i2c::ERROR_OK);
 }
 
 
-void FRAM::write8(uint16_t memaddr, uint8_t value)
+////////////////////////////////////////////////////////////////////////
+
+
+int32_t FRAM::readUntil(uint32_t memaddr, char * buf, uint16_t buflen, char separator)
+{
+  int32_t length = this->_readUntil(memaddr, buf, buflen, separator);
+  if (length >= 0)
+  {
+    buf[length] = 0;    //  replace separator => \0 EndChar
+  }
+  //  -1 => entry does not fit in given buffer.
+  return length;
+}
+
+
+int32_t FRAM::readLine(uint32_t memaddr, char * buf, uint16_t buflen)
 {
-  uint8_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint8_t));
+  if (buflen == 0) return (int32_t)-1;
+  int32_t length = this->_readUntil(memaddr, buf, buflen - 1, '\n');
+  if (length >= 0)
+  {
+    buf[length + 1] = 0;    //  add \0 EndChar after '\n'
+    return length + 1;
+  }
+  //  entry does not fit in given buffer.
+  return length;
 }
 
 
-void FRAM::write16(uint16_t memaddr, uint16_t value)
+////////////////////////////////////////////////////////////////////////
+
+
+uint16_t FRAM::getManufacturerID()
 {
-  uint16_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint16_t));
+  return this->_getMetaData(0);
 }
 
 
-void FRAM::write32(uint16_t memaddr, uint32_t value)
+uint16_t FRAM::getProductID()
 {
-  uint32_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint32_t));
+  return this->_getMetaData(1);
 }
 
 
-void FRAM::writeFloat(uint16_t memaddr, float value)
+// NOTE: returns the size in kiloBYTE
+uint16_t FRAM::getSize()
 {
-  float val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(float));
+  uint16_t density = this->_getMetaData(2);
+  uint16_t size = 0;
+  if (density > 0)
+  {
+    size = (1UL << density);
+    this->_sizeBytes = size * 1024UL;
+  }
+  return size;
 }
 
 
-void FRAM::writeDouble(uint16_t memaddr, double value)
+uint32_t FRAM::getSizeBytes()
 {
-  double val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(double));
+  return this->_sizeBytes;
 }
 
 
-void FRAM::write(uint16_t memaddr, uint8_t * obj, uint16_t size)
+//  override to be used when getSize() fails == 0
+void FRAM::setSizeBytes(uint32_t value)
 {
-  const int blocksize = 24;
-  uint8_t * p = obj;
-  while (size >= blocksize)
+  this->_sizeBytes = value;
+}
+
+
+void FRAM::setWriteBuffer(uint16_t size)
+{
+  size_t lines = (size + FRAM_WB_LINE - 1) / FRAM_WB_LINE;
+  this->_wbLines.resize(lines, {0, 0, {}});
+  this->_wbOrder.reserve(lines);
+}
+
+
+//  dirty bytes in address order, consecutive runs in one transaction
+void FRAM::flush()
+{
+  FRAM_LOCK();
+  if (!this->_wbDirty) return;
+  this->_wbDirty = false;
+
+  this->_wbOrder.clear();
+  for (auto & line : this->_wbLines)
   {
-    this->_writeBlock(memaddr, p, blocksize);
-    memaddr += blocksize;
-    p += blocksize;
-    size -= blocksize;
+    if (line.dirty) this->_wbOrder.push_back(&line);
   }
-  //  remaining
-  if (size > 0)
+  std::sort(this->_wbOrder.begin(), this->_wbOrder.end(),
+    [](FRAM_WBLINE * a, FRAM_WBLINE * b) { return a->addr < b->addr; });
+
+  //  lines do not cross a page, runs of lines might
+  uint32_t page = this->_pageSize();
+  i2c::WriteBuffer buff[FRAM_WB_SEGMENTS + 1];
+  size_t   cnt = 1;
+  uint32_t start = 0;
+  uint32_t next = 0;
+  uint32_t len = 0;
+
+  for (auto * line : this->_wbOrder)
+  {
+    uint8_t i = 0;
+    while (i < FRAM_WB_LINE)
+    {
+      if (!(line->dirty & (1UL << i)))
+      {
+        i++;
+        continue;
+      }
+
+      uint32_t addr = line->addr + i;
+      if ((cnt > 1) && ((addr != next) || (cnt > FRAM_WB_SEGMENTS) || (len >= this->_maxTransfer) || !(addr & (page - 1))))
+      {
+        this->_writev(start, buff, cnt);
+        cnt = 1;
+      }
+      if (cnt == 1)
+      {
+        start = addr;
+        len = 0;
+      }
+
+      uint8_t j = i;
+      while ((j < FRAM_WB_LINE) && (line->dirty & (1UL << j)) && (len + (j - i) < this->_maxTransfer)) j++;
+
+      buff[cnt].data = line->data + i;
+      buff[cnt].len = j - i;
+      cnt++;
+      len += j - i;
+      next = addr + (j - i);
+      i = j;
+    }
+    line->dirty = 0;
+  }
+
+  if (cnt > 1)
   {
-    this->_writeBlock(memaddr, p, size);
+    this->_writev(start, buff, cnt);
   }
 }
 
 
-uint8_t FRAM::read8(uint16_t memaddr)
+//  line_size must be a power of 2
+void FRAM::setReadCache(uint8_t line_size, uint16_t lines)
 {
-  uint8_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint8_t));
-  return val;
+  this->_cacheLineSize = line_size;
+  this->_cacheSets = std::max<uint16_t>(lines / FRAM_CACHE_WAYS, 1);
+  this->_cacheTags.assign(this->_cacheSets * FRAM_CACHE_WAYS, FRAM_CACHE_EMPTY);
+  this->_cacheData.resize(this->_cacheSets * FRAM_CACHE_WAYS * line_size);
+  this->_cacheNext.assign(this->_cacheSets, 0);
 }
 
 
-uint16_t FRAM::read16(uint16_t memaddr)
+void FRAM::invalidate()
 {
-  uint16_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint16_t));
-  return val;
+  FRAM_LOCK();
+  std::fill(this->_cacheTags.begin(), this->_cacheTags.end(), FRAM_CACHE_EMPTY);
 }
 
 
-uint32_t FRAM::read32(uint16_t memaddr)
+#ifdef USE_FRAM_STATS
+uint32_t FRAM::getErrors()
 {
-  uint32_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint32_t));
-  return val;
+  uint32_t errors = 0;
+  for (auto e : this->_stats.errors) errors += e;
+  return errors;
 }
 
 
-float FRAM::readFloat(uint16_t memaddr)
+void FRAM::resetStats()
 {
-  float val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(float));
-  return val;
+  this->_stats = {};
 }
+#endif
 
 
-double FRAM::readDouble(uint16_t memaddr)
+uint32_t FRAM::wireTime(uint32_t size, bool read)
 {
-  double val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(double));
-  return val;
+  uint8_t addrlen = this->_addressing.bytes;
+  uint32_t blocks = (size + this->_maxTransfer - 1) / this->_maxTransfer;
+  uint64_t cycles = (uint64_t)blocks * wireCycles(addrlen, 0, read) + (uint64_t)size * 9;
+  return cycles * 1000000 / this->_busFrequency;
 }
 
 
-void FRAM::read(uint16_t memaddr, uint8_t * obj, uint16_t size)
+uint32_t FRAM::clear(uint8_t value, FRAMProgress progress)
 {
-  const uint8_t blocksize = 24;
-  uint8_t * p = obj;
-  while (size >= blocksize)
+  return this->fill(0, this->_sizeBytes, value, progress);
+}
+
+
+uint32_t FRAM::fill(uint32_t memaddr, uint32_t len, uint8_t value, FRAMProgress progress)
+{
+  FRAM_LOCK();
+  uint8_t pattern[FRAM_FILL_PATTERN];
+  memset(pattern, value, FRAM_FILL_PATTERN);
+
+  //  same pattern repeated in one transaction, nothing to allocate
+  i2c::WriteBuffer buff[FRAM_FILL_REPEAT + 1];
+  uint32_t blocksize = FRAM_FILL_PATTERN * FRAM_FILL_REPEAT;
+  this->_bufferDiscard(memaddr, len);
+  this->_cacheWrite(memaddr, nullptr, len);
+  uint32_t done = 0;
+  while (done < len)
   {
-    this->_readBlock(memaddr, p, blocksize);
-    memaddr += blocksize;
-    p += blocksize;
-    size -= blocksize;
+    uint32_t n = this->_blockSize(memaddr + done, std::min<uint32_t>(blocksize, len - done));
+    size_t cnt = 1;
+    for (uint32_t i = 0; i < n; i += FRAM_FILL_PATTERN, cnt++)
+    {
+      buff[cnt].data = pattern;
+      buff[cnt].len = std::min<uint32_t>(FRAM_FILL_PATTERN, n - i);
+    }
+    this->_writev(memaddr + done, buff, cnt);
+    done += n;
+
+    if (progress) progress(done, len);
+    this->_feedWatchdog();
   }
-  // remainder
-  if (size > 0)
+  return done;
+}
+
+
+void FRAM::readv(FRAM_SEGMENT * segs, uint8_t cnt)
+{
+  FRAM_LOCK();
+  uint8_t order[255];
+  this->_sortSegments(segs, cnt, order);
+
+  //  holes are read into one scratch buffer
+  uint8_t hole[255];
+  i2c::ReadBuffer buff[FRAM_VECTOR_MAX * 2];
+
+  for (uint8_t i = 0, j; i < cnt; i = j)
   {
-    this->_readBlock(memaddr, p, size);
+    FRAM_SEGMENT & first = segs[order[i]];
+    uint32_t start = first.memaddr;
+    uint32_t end = start + first.size;
+    size_t   n = 0;
+    buff[n++] = {first.obj, first.size};
+
+    for (j = i + 1; j < cnt && n + 2 <= FRAM_VECTOR_MAX * 2; j++)
+    {
+      FRAM_SEGMENT & seg = segs[order[j]];
+      if (seg.memaddr < end || seg.memaddr - end > this->_gapThreshold) break;
+      uint32_t len = seg.memaddr + seg.size - start;
+      if (this->_blockSize(start, len) < len) break;
+
+      if (seg.memaddr > end) buff[n++] = {hole, seg.memaddr - end};
+      buff[n++] = {seg.obj, seg.size};
+      end = seg.memaddr + seg.size;
+    }
+
+    if (j == i + 1)
+    {
+      //  alone, through the cache and split as needed
+      this->_read(first.memaddr, first.obj, first.size);
+      continue;
+    }
+
+    this->_readv(start, buff, n);
+    if (!this->_wbDirty) continue;
+    for (uint8_t k = i; k < j; k++)
+    {
+      this->_bufferRead(segs[order[k]].memaddr, segs[order[k]].obj, segs[order[k]].size);
+    }
   }
 }
 
 
-////////////////////////////////////////////////////////////////////////
+void FRAM::writev(FRAM_SEGMENT * segs, uint8_t cnt)
+{
+  FRAM_LOCK();
+  uint8_t order[255];
+  this->_sortSegments(segs, cnt, order);
 
+  i2c::WriteBuffer buff[FRAM_VECTOR_MAX + 1];
 
-int32_t FRAM::readUntil(uint16_t memaddr, char * buf, uint16_t buflen, char separator)
+  for (uint8_t i = 0, j; i < cnt; i = j)
+  {
+    FRAM_SEGMENT & first = segs[order[i]];
+    uint32_t start = first.memaddr;
+    uint32_t end = start + first.size;
+    size_t   n = 1;
+    buff[n++] = {first.obj, first.size};
+
+    //  no holes, they would be overwritten
+    for (j = i + 1; j < cnt && n <= FRAM_VECTOR_MAX; j++)
+    {
+      FRAM_SEGMENT & seg = segs[order[j]];
+      if (seg.memaddr != end) break;
+      uint32_t len = end + seg.size - start;
+      if (this->_blockSize(start, len) < len) break;
+
+      buff[n++] = {seg.obj, seg.size};
+      end += seg.size;
+    }
+
+    if (j == i + 1)
+    {
+      this->_write(first.memaddr, first.obj, first.size);
+      continue;
+    }
+
+    for (uint8_t k = i; k < j; k++)
+    {
+      FRAM_SEGMENT & seg = segs[order[k]];
+      this->_cacheWrite(seg.memaddr, seg.obj, seg.size);
+      if (!this->_wbLines.empty()) this->_bufferDiscard(seg.memaddr, seg.size);
+    }
+    this->_writev(start, buff, n);
+  }
+}
+
+
+uint32_t FRAM::writeCompressed(uint32_t memaddr, const uint8_t * obj, uint32_t size)
 {
-  //  read and fill the buffer at once.
-  this->read(memaddr, (uint8_t *)buf, buflen);
-  for (uint16_t length = 0; length < buflen; length++)
+  FRAM_LOCK();
+  const uint32_t window = 1UL << FRAM_LZ_WINDOW_BITS;
+  const uint32_t longest = (1UL << FRAM_LZ_LENGTH_BITS) + FRAM_LZ_MIN_MATCH - 1;
+  uint32_t data = memaddr + sizeof(FRAM_BLOB);
+  uint8_t  out[FRAM_LZ_BUFFER];
+  uint32_t bits = 0;
+  uint32_t stored = 0;
+
+  //  an old header must not describe the new bytes if the write is cut,
+  //  stored > size reads as damaged. flushed, large writes skip the buffer.
+  FRAM_BLOB blob{0, ~FRAM_BLOB_RAW};
+  this->_write(memaddr, (uint8_t *)&blob, sizeof(blob));
+  this->flush();
+
+  //  bits are written out FRAM_LZ_BUFFER bytes at a time.
+  //  nothing is written from data + size on, that is raw storage anyway.
+  auto put = [&](uint32_t value, uint8_t n) {
+    while (n-- && stored < size)
+    {
+      if (!(bits & 7)) out[bits >> 3] = 0;
+      if ((value >> n) & 1) out[bits >> 3] |= 0x80 >> (bits & 7);
+      if (++bits < FRAM_LZ_BUFFER * 8) continue;
+      if (stored + FRAM_LZ_BUFFER < size) this->_write(data + stored, out, FRAM_LZ_BUFFER);
+      stored += FRAM_LZ_BUFFER;
+      bits = 0;
+    }
+  };
+
+  //  longest match in the window, overlapping the current position
+  for (uint32_t pos = 0; pos < size && stored < size; )
   {
-    if (buf[length] == separator)
+    uint32_t best = 0;
+    uint32_t dist = 0;
+    uint32_t limit = std::min(longest, size - pos);
+    for (uint32_t d = 1; d <= window && d <= pos; d++)
+    {
+      const uint8_t * p = obj + pos - d;
+      if (p[best] != obj[pos + best] || p[0] != obj[pos]) continue;
+      uint32_t len = 0;
+      while (len < limit && p[len] == obj[pos + len]) len++;
+      if (len <= best) continue;
+      best = len;
+      dist = d;
+      if (best == limit) break;
+    }
+
+    if (best >= FRAM_LZ_MIN_MATCH)
     {
-      buf[length] = 0;    //  replace separator => \0 EndChar
-      return length;
+      put(0, 1);
+      put(dist - 1, FRAM_LZ_WINDOW_BITS);
+      put(best - FRAM_LZ_MIN_MATCH, FRAM_LZ_LENGTH_BITS);
+      pos += best;
+    }
+    else
+    {
+      put(1, 1);
+      put(obj[pos], 8);
+      pos++;
     }
   }
-  //  entry does not fit in given buffer.
-  return (int32_t)-1;
+
+  if (bits && stored < size)
+  {
+    uint32_t len = (bits + 7) >> 3;
+    if (stored + len < size) this->_write(data + stored, out, len);
+    stored += len;
+  }
+
+  if (stored >= size)
+  {
+    this->_write(data, (uint8_t *)obj, size);
+    stored = size | FRAM_BLOB_RAW;
+  }
+
+  //  header last, a blob is readable only when complete.
+  //  the write buffer flushes in address order, the header is lower
+  this->flush();
+  blob = {size, stored};
+  this->_write(memaddr, (uint8_t *)&blob, sizeof(blob));
+
+  stored &= ~FRAM_BLOB_RAW;
+  ESP_LOGD(TAG, "Blob at %u: %u bytes stored in %u (%.2fx)", memaddr, size, stored,
+    stored ? (float)size / stored : 1.0f);
+  return sizeof(blob) + stored;
 }
 
 
-int32_t FRAM::readLine(uint16_t memaddr, char * buf, uint16_t buflen)
+int32_t FRAM::readCompressed(uint32_t memaddr, uint8_t * obj, uint32_t buflen)
 {
-  //  read and fill the buffer at once.
-  this->read(memaddr, (uint8_t *)buf, buflen);
-  for (uint16_t length = 0; length < buflen-1; length++)
+  FRAM_LOCK();
+  FRAM_BLOB blob;
+  this->_read(memaddr, (uint8_t *)&blob, sizeof(blob));
+  uint32_t stored = blob.stored & ~FRAM_BLOB_RAW;
+  if (stored > blob.size || blob.size > buflen) return -1;
+
+  uint32_t data = memaddr + sizeof(FRAM_BLOB);
+  if (blob.stored & FRAM_BLOB_RAW)
+  {
+    this->_read(data, obj, blob.size);
+    return blob.size;
+  }
+
+  uint8_t  in[FRAM_LZ_BUFFER];
+  uint32_t next = 0;
+  uint32_t bits = 0;
+  uint32_t bit = 0;
+  bool     damaged = false;
+
+  auto get = [&](uint8_t n) -> uint32_t {
+    uint32_t value = 0;
+    while (n--)
+    {
+      if (bit == bits)
+      {
+        uint32_t len = std::min<uint32_t>(FRAM_LZ_BUFFER, stored - next);
+        if (!len) { damaged = true; return 0; }
+        this->_read(data + next, in, len);
+        next += len;
+        bits = len * 8;
+        bit = 0;
+      }
+      value = (value << 1) | ((in[bit >> 3] >> (7 - (bit & 7))) & 1);
+      bit++;
+    }
+    return value;
+  };
+
+  //  back references copy from what was decoded into obj
+  uint32_t out = 0;
+  while (out < blob.size && !damaged)
   {
-    if (buf[length] == '\n')
+    if (get(1))
     {
-      buf[length + 1] = 0;    //  add \0 EndChar after '\n'
-      return length + 1;
+      obj[out++] = get(8);
+      continue;
     }
+    uint32_t dist = get(FRAM_LZ_WINDOW_BITS) + 1;
+    uint32_t len = get(FRAM_LZ_LENGTH_BITS) + FRAM_LZ_MIN_MATCH;
+    if (dist > out || len > blob.size - out) damaged = true;
+    for (; !damaged && len; len--, out++) obj[out] = obj[out - dist];
   }
-  //  entry does not fit in given buffer.
-  return (int32_t)-1;
+
+  if (damaged) ESP_LOGW(TAG, "Blob at %u is damaged", memaddr);
+  return damaged ? -1 : (int32_t)blob.size;
 }
 
 
-////////////////////////////////////////////////////////////////////////
+bool FRAM::getBlobInfo(uint32_t memaddr, uint32_t & size, uint32_t & stored)
+{
+  FRAM_BLOB blob;
+  this->_read(memaddr, (uint8_t *)&blob, sizeof(blob));
+  size = blob.size;
+  stored = blob.stored & ~FRAM_BLOB_RAW;
+  return stored <= size;
+}
 
 
-uint16_t FRAM::getManufacturerID()
+bool FRAM::startRead(uint32_t memaddr, uint8_t * obj, uint32_t size, FRAMProgress progress)
 {
-  return this->_getMetaData(0);
+  return this->_startOperation({FRAM_OPERATION::READ, 0, memaddr, 0, size, 0, obj, progress});
 }
 
 
-uint16_t FRAM::getProductID()
+bool FRAM::startWrite(uint32_t memaddr, uint8_t * obj, uint32_t size, FRAMProgress progress)
 {
-  return this->_getMetaData(1);
+  return this->_startOperation({FRAM_OPERATION::WRITE, 0, memaddr, 0, size, 0, obj, progress});
 }
 
 
-// NOTE: returns the size in kiloBYTE
-uint16_t FRAM::getSize()
+bool FRAM::startFill(uint32_t memaddr, uint32_t len, uint8_t value, FRAMProgress progress)
 {
-  uint16_t density = this->_getMetaData(2);
-  uint16_t size = 0;
-  if (density > 0)
+  return this->_startOperation({FRAM_OPERATION::FILL, value, memaddr, 0, len, 0, nullptr, progress});
+}
+
+
+bool FRAM::startClear(uint8_t value, FRAMProgress progress)
+{
+  return this->startFill(0, this->_sizeBytes, value, progress);
+}
+
+
+bool FRAM::startCopy(uint32_t from, uint32_t to, uint32_t len, FRAMProgress progress)
+{
+  return this->_startOperation({FRAM_OPERATION::COPY, 0, to, from, len, 0, nullptr, progress});
+}
+
+
+float FRAM::getProgress()
+{
+  if (!this->_operation.size) return 100.0f;
+  return 100.0f * this->_operation.done / this->_operation.size;
+}
+
+
+bool FRAM::_startOperation(const FRAM_OPERATION & op)
+{
+  if (this->isBusy()) return false;
+  this->_operation = op;
+  return true;
+}
+
+
+//  at least one block per call, then as many as fit in _timeBudget
+void FRAM::_operationStep()
+{
+  FRAM_OPERATION & op = this->_operation;
+  uint32_t blocksize = this->_maxTransfer;
+  uint32_t start = micros();
+
+  if (op.type == FRAM_OPERATION::COPY)
   {
-    size = (1UL << density);
-    this->_sizeBytes = size * 1024UL;
+    blocksize = std::min<uint32_t>(blocksize, FRAM_COPY_BLOCK);
+  }
+
+  do
+  {
+    uint32_t n = std::min<uint32_t>(blocksize, op.size - op.done);
+    uint32_t offset = op.done;
+
+    switch (op.type)
+    {
+      case FRAM_OPERATION::READ:
+        this->_read(op.memaddr + offset, op.obj + offset, n);
+        break;
+      case FRAM_OPERATION::WRITE:
+        this->_write(op.memaddr + offset, op.obj + offset, n);
+        break;
+      case FRAM_OPERATION::FILL:
+        this->fill(op.memaddr + offset, n, op.value);
+        break;
+      case FRAM_OPERATION::COPY:
+      {
+        //  copy from the end when moving up into an overlapping range
+        if ((op.memaddr > op.from) && (op.memaddr < op.from + op.size))
+        {
+          offset = op.size - op.done - n;
+        }
+        uint8_t buffer[FRAM_COPY_BLOCK];
+        this->_read(op.from + offset, buffer, n);
+        this->_write(op.memaddr + offset, buffer, n);
+        break;
+      }
+      default:
+        break;
+    }
+
+    op.done += n;
+  }
+  while ((op.done < op.size) && (micros() - start < this->_timeBudget));
+
+  if (op.progress) op.progress(op.done, op.size);
+
+  if (op.done >= op.size)
+  {
+    op.type = FRAM_OPERATION::NONE;
+    op.progress = nullptr;
+    this->_onComplete.call();
   }
-  return size;
 }
 
 
-uint32_t FRAM::getSizeBytes()
+#ifdef USE_FRAM_ASYNC
+void FRAM::setAsync(uint8_t queue_size, uint8_t priority, int8_t core)
 {
-  return this->_sizeBytes;
+  this->_asyncQueueSize = queue_size;
+  this->_asyncPriority = priority;
+  this->_asyncCore = core;
 }
 
 
-//  override to be used when getSize() fails == 0
-void FRAM::setSizeBytes(uint32_t value)
+bool FRAM::readAsync(uint32_t memaddr, uint8_t * obj, uint32_t size, std::function<void()> && done)
 {
-  this->_sizeBytes = value;
+  return this->_asyncSubmit(new FRAM_REQUEST{FRAM_REQUEST::READ, 0, memaddr, size, obj, std::move(done)});
 }
 
 
-uint32_t FRAM::clear(uint8_t value)
+bool FRAM::writeAsync(uint32_t memaddr, uint8_t * obj, uint32_t size, std::function<void()> && done)
 {
-  uint8_t buffer[16];
-  for (uint8_t i = 0; i < 16; i++) buffer[i] = value;
-  uint32_t start = 0;
-  uint32_t end = this->_sizeBytes;
-  for (uint32_t address = start; address < end; address += 16)
+  return this->_asyncSubmit(new FRAM_REQUEST{FRAM_REQUEST::WRITE, 0, memaddr, size, obj, std::move(done)});
+}
+
+
+bool FRAM::fillAsync(uint32_t memaddr, uint32_t len, uint8_t value, std::function<void()> && done)
+{
+  return this->_asyncSubmit(new FRAM_REQUEST{FRAM_REQUEST::FILL, value, memaddr, len, nullptr, std::move(done)});
+}
+
+
+bool FRAM::_asyncSubmit(FRAM_REQUEST * req)
+{
+  if (!this->_asyncQueue || (xQueueSend(this->_asyncQueue, &req, 0) != pdTRUE))
   {
-    this->_writeBlock(address, buffer, 16);
+    delete req;
+    return false;
   }
-  return end - start;
+  return true;
 }
 
 
+void FRAM::_asyncTask(void * arg)
+{
+  FRAM * fram = (FRAM *)arg;
+  FRAM_REQUEST * req;
+  while (true)
+  {
+    if (xQueueReceive(fram->_asyncQueue, &req, portMAX_DELAY) != pdTRUE) continue;
+
+    switch (req->type)
+    {
+      case FRAM_REQUEST::READ:
+        fram->_read(req->memaddr, req->obj, req->size);
+        break;
+      case FRAM_REQUEST::WRITE:
+        fram->_write(req->memaddr, req->obj, req->size);
+        fram->flush();
+        break;
+      case FRAM_REQUEST::FILL:
+        fram->fill(req->memaddr, req->size, req->value);
+        break;
+    }
+
+    xQueueSend(fram->_asyncDone, &req, portMAX_DELAY);
+  }
+}
+#endif
+
+
 //  EXPERIMENTAL - to be confirmed
 //  page 12 datasheet
 //  command = S 0xF8 A address A S 86 A P  (A = Ack from slave )
 void FRAM::sleep()
 {
+  FRAM_LOCK();
+  this->flush();
   uint8_t addr = this->address_ << 1;
   this->bus_->write(FRAM_SLAVE_ID_, &addr, 1, false);
   this->bus_->write(FRAM_SLEEP_CMD >> 1, nullptr, 0, true);
+
+  if (this->_asleep) return;
+  this->_asleep = true;
+  this->_sleepSince = millis();
+  this->_sleeps++;
 }
 
 
 //  page 12 datasheet   trec <= 400us
 bool FRAM::wakeup(uint32_t trec)
 {
+  FRAM_LOCK();
+  if (this->_asleep)
+  {
+    this->_asleep = false;
+    this->_sleepTime += millis() - this->_sleepSince;
+    this->_wakes++;
+  }
+
   bool b = this->isConnected();  //  wakeup
   if (trec == 0) return b;
   //  wait recovery time
@@ -290,11 +874,26 @@ bool FRAM::wakeup(uint32_t trec)
 }
 
 
+uint32_t FRAM::getSleepTime()
+{
+  uint32_t ms = this->_sleepTime;
+  if (this->_asleep) ms += millis() - this->_sleepSince;
+  return ms;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // FRAM PROTECTED
 //
 
+void FRAM::_wake()
+{
+  if (this->_asleep) this->wakeup(this->_trec);
+  this->_lastAccess = millis();
+}
+
+
 //  metadata is packed as  [....MMMM][MMMMDDDD][PPPPPPPP]
 //  M = manufacturerID
 //  D = density => memory size = 2^D KB
@@ -302,7 +901,9 @@ bool FRAM::wakeup(uint32_t trec)
 //  P part might be proprietary
 uint16_t FRAM::_getMetaData(uint8_t field)
 {
+  FRAM_LOCK();
   if (field > 2) return 0;
+  this->_wake();
 
   uint8_t addr = this->address_ << 1;
   this->bus_->write(FRAM_SLAVE_ID_, &addr, 1, false);
@@ -326,300 +927,468 @@ uint16_t FRAM::_getMetaData(uint8_t field)
 }
 
 
-void FRAM::_writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+void FRAM::_feedWatchdog()
 {
-  i2c::WriteBuffer buff[2];
-  uint8_t maddr[] = { (uint8_t)(memaddr >> 8), (uint8_t)(memaddr & 0xFF) };
-
-  buff[0].data = maddr;
-  buff[0].len = 2;
-  buff[1].data = obj;
-  buff[1].len = size;
-
-  this->bus_->writev(this->address_, buff, 2, true);
+#ifdef USE_FRAM_ASYNC
+  //  the worker task is not subscribed to the task watchdog,
+  //  and feed_wdt() runs the status led from the calling task
+  if (xTaskGetCurrentTaskHandle() != this->_loopTask) return;
+#endif
+  App.feed_wdt();
 }
 
 
-void FRAM::_readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+void FRAM::_write(uint32_t memaddr, uint8_t * obj, uint32_t size)
 {
-  uint8_t maddr[] = { (uint8_t)(memaddr >> 8), (uint8_t)(memaddr & 0xFF) };
-  this->bus_->write(this->address_, maddr, 2, false);
-  this->bus_->read(this->address_, obj, size);
-}
+  FRAM_LOCK();
+  this->_cacheWrite(memaddr, obj, size);
 
+  if (!this->_wbLines.empty())
+  {
+    //  a full transaction has nothing to merge with, and writes near
+    //  the buffer size would only force a flush of everything else
+    uint32_t limit = std::min<uint32_t>(this->_maxTransfer - 1, this->_wbLines.size() * FRAM_WB_LINE / 2);
+    if (size <= limit)
+    {
+      this->_bufferWrite(memaddr, obj, size);
+      return;
+    }
+    this->_bufferDiscard(memaddr, size);
+  }
+
+  uint8_t * p = obj;
+  while (size > 0)
+  {
+    uint16_t blocksize = this->_blockSize(memaddr, size);
+    this->_writeBlock(memaddr, p, blocksize);
+    memaddr += blocksize;
+    p += blocksize;
+    size -= blocksize;
+  }
+}
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//  FRAM32  PUBLIC
-//
 
-void FRAM32::write8(uint32_t memaddr, uint8_t value)
+void FRAM::_read(uint32_t memaddr, uint8_t * obj, uint32_t size)
 {
-  uint8_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint8_t));
+  FRAM_LOCK();
+  if (this->_cacheSets && (size <= this->_cacheLineSize))
+  {
+    this->_cacheRead(memaddr, obj, size);
+  }
+  else
+  {
+    this->_readBlocks(memaddr, obj, size);
+  }
+
+  if (this->_wbDirty)
+  {
+    this->_bufferRead(memaddr, obj, size);
+  }
 }
 
 
-void FRAM32::write16(uint32_t memaddr, uint16_t value)
+void FRAM::_readBlocks(uint32_t memaddr, uint8_t * obj, uint32_t size)
 {
-  uint16_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint16_t));
+  uint8_t * p = obj;
+  while (size > 0)
+  {
+    uint16_t blocksize = this->_blockSize(memaddr, size);
+    this->_readBlock(memaddr, p, blocksize);
+    memaddr += blocksize;
+    p += blocksize;
+    size -= blocksize;
+  }
 }
 
 
-void FRAM32::write32(uint32_t memaddr, uint32_t value)
+//  line size is a power of 2 and at most 128,
+//  a line never crosses a FRAM9/FRAM11/FRAM32 page
+void FRAM::_cacheRead(uint32_t memaddr, uint8_t * obj, uint32_t size)
 {
-  uint32_t val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(uint32_t));
+  while (size > 0)
+  {
+    uint32_t base = memaddr & ~(uint32_t)(this->_cacheLineSize - 1);
+    uint8_t  offset = memaddr - base;
+    uint8_t  n = std::min<uint32_t>(size, this->_cacheLineSize - offset);
+
+    uint16_t set = (base / this->_cacheLineSize) % this->_cacheSets;
+    uint16_t first = set * FRAM_CACHE_WAYS;
+    uint16_t way = first;
+    while ((way < first + FRAM_CACHE_WAYS) && (this->_cacheTags[way] != base)) way++;
+
+    if (way < first + FRAM_CACHE_WAYS)
+    {
+      this->_cacheHits++;
+    }
+    else
+    {
+      //  round robin in the set
+      this->_cacheMisses++;
+      way = first + this->_cacheNext[set];
+      this->_cacheNext[set] = (this->_cacheNext[set] + 1) % FRAM_CACHE_WAYS;
+      this->_readBlocks(base, &this->_cacheData[way * this->_cacheLineSize], this->_cacheLineSize);
+      this->_cacheTags[way] = base;
+      //  the line must not miss writes still in the write buffer
+      if (this->_wbDirty)
+      {
+        this->_bufferRead(base, &this->_cacheData[way * this->_cacheLineSize], this->_cacheLineSize);
+      }
+    }
+
+    memcpy(obj, &this->_cacheData[way * this->_cacheLineSize + offset], n);
+    memaddr += n;
+    obj += n;
+    size -= n;
+  }
 }
 
 
-void FRAM32::writeFloat(uint32_t memaddr, float value)
+void FRAM::_cacheWrite(uint32_t memaddr, const uint8_t * obj, uint32_t size)
 {
-  float val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(float));
+  if (!this->_cacheSets) return;
+
+  uint32_t end = memaddr + size;
+  for (size_t way = 0; way < this->_cacheTags.size(); way++)
+  {
+    uint32_t tag = this->_cacheTags[way];
+    if ((tag == FRAM_CACHE_EMPTY) || (tag >= end) || (tag + this->_cacheLineSize <= memaddr)) continue;
+
+    if (obj == nullptr)
+    {
+      this->_cacheTags[way] = FRAM_CACHE_EMPTY;
+      continue;
+    }
+
+    uint32_t from = std::max(tag, memaddr);
+    uint32_t to = std::min<uint32_t>(tag + this->_cacheLineSize, end);
+    memcpy(&this->_cacheData[way * this->_cacheLineSize + (from - tag)], obj + (from - memaddr), to - from);
+  }
 }
 
 
-void FRAM32::writeDouble(uint32_t memaddr, double value)
+//  bit mask for n bytes of a line from offset
+static uint32_t lineMask(uint8_t offset, uint8_t n)
 {
-  double val = value;
-  this->_writeBlock(memaddr, (uint8_t *)&val, sizeof(double));
+  uint32_t mask = (n >= 32) ? 0xFFFFFFFFUL : ((1UL << n) - 1);
+  return mask << offset;
 }
 
 
-void FRAM32::write(uint32_t memaddr, uint8_t * obj, uint16_t size)
+void FRAM::_bufferWrite(uint32_t memaddr, const uint8_t * obj, uint32_t size)
 {
-  const int blocksize = 24;
-  uint8_t * p = obj;
-  while (size >= blocksize)
+  while (size > 0)
   {
-    this->_writeBlock(memaddr, p, blocksize);
-    memaddr += blocksize;
-    p += blocksize;
-    size -= blocksize;
-  }
-  // remaining
-  if (size > 0)
-  {
-    this->_writeBlock(memaddr, p, size);
+    uint32_t base = memaddr - (memaddr % FRAM_WB_LINE);
+    uint8_t  offset = memaddr - base;
+    uint8_t  n = std::min<uint32_t>(size, FRAM_WB_LINE - offset);
+
+    FRAM_WBLINE * line = nullptr;
+    FRAM_WBLINE * free = nullptr;
+    for (auto & l : this->_wbLines)
+    {
+      if (!l.dirty)
+      {
+        if (!free) free = &l;
+      }
+      else if (l.addr == base)
+      {
+        line = &l;
+        break;
+      }
+    }
+
+    if (!line)
+    {
+      if (!free)
+      {
+        //  full, all lines are free after this
+        this->flush();
+        free = &this->_wbLines[0];
+      }
+      line = free;
+      line->addr = base;
+    }
+
+    memcpy(line->data + offset, obj, n);
+    line->dirty |= lineMask(offset, n);
+
+    if (!this->_wbDirty)
+    {
+      this->_wbDirty = true;
+      this->_wbSince = millis();
+    }
+
+    memaddr += n;
+    obj += n;
+    size -= n;
   }
 }
 
 
-uint8_t FRAM32::read8(uint32_t memaddr)
+void FRAM::_bufferRead(uint32_t memaddr, uint8_t * obj, uint32_t size)
 {
-  uint8_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint8_t));
-  return val;
+  uint32_t end = memaddr + size;
+  for (auto & line : this->_wbLines)
+  {
+    if (!line.dirty || (line.addr >= end) || (line.addr + FRAM_WB_LINE <= memaddr)) continue;
+
+    uint32_t from = std::max(line.addr, memaddr);
+    uint32_t to = std::min<uint32_t>(line.addr + FRAM_WB_LINE, end);
+    for (uint32_t a = from; a < to; a++)
+    {
+      if (line.dirty & (1UL << (a - line.addr))) obj[a - memaddr] = line.data[a - line.addr];
+    }
+  }
 }
 
 
-uint16_t FRAM32::read16(uint32_t memaddr)
+void FRAM::_bufferDiscard(uint32_t memaddr, uint32_t size)
 {
-  uint16_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint16_t));
-  return val;
-}
+  if (!this->_wbDirty) return;
 
+  uint32_t end = memaddr + size;
+  for (auto & line : this->_wbLines)
+  {
+    if (!line.dirty || (line.addr >= end) || (line.addr + FRAM_WB_LINE <= memaddr)) continue;
 
-uint32_t FRAM32::read32(uint32_t memaddr)
-{
-  uint32_t val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(uint32_t));
-  return val;
+    uint32_t from = std::max(line.addr, memaddr);
+    uint32_t to = std::min<uint32_t>(line.addr + FRAM_WB_LINE, end);
+    line.dirty &= ~lineMask(from - line.addr, to - from);
+  }
 }
 
 
-float FRAM32::readFloat(uint32_t memaddr)
+int32_t FRAM::_readUntil(uint32_t memaddr, char * buf, uint16_t limit, char separator)
 {
-  float val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(float));
-  return val;
+  //  grow the block, short records cost one small read
+  uint32_t blocksize = FRAM_SCAN_BLOCK;
+  uint16_t length = 0;
+  while (length < limit)
+  {
+    uint16_t n = std::min<uint32_t>(blocksize, limit - length);
+    this->_read(memaddr + length, (uint8_t *)buf + length, n);
+    int32_t pos = findByte((uint8_t *)buf + length, n, separator);
+    if (pos >= 0) return length + pos;
+    length += n;
+    if (blocksize < this->_maxTransfer) blocksize *= 2;
+  }
+  return (int32_t)-1;
 }
 
 
-double FRAM32::readDouble(uint32_t memaddr)
+void FRAM::_writeBlock(uint32_t memaddr, uint8_t * obj, uint16_t size)
 {
-  double val;
-  this->_readBlock(memaddr, (uint8_t *)&val, sizeof(double));
-  return val;
+  i2c::WriteBuffer buff[2];
+  buff[1].data = obj;
+  buff[1].len = size;
+
+  this->_writev(memaddr, buff, 2);
 }
 
 
-void FRAM32::read(uint32_t memaddr, uint8_t * obj, uint16_t size)
+void FRAM::_readBlock(uint32_t memaddr, uint8_t * obj, uint16_t size)
 {
-  const uint8_t blocksize = 24;
-  uint8_t * p = obj;
-  while (size >= blocksize)
-  {
-    this->_readBlock(memaddr, p, blocksize);
-    memaddr += blocksize;
-    p += blocksize;
-    size -= blocksize;
-  }
-  // remainder
-  if (size > 0)
-  {
-    this->_readBlock(memaddr, p, size);
-  }
+  i2c::ReadBuffer buff{obj, size};
+  this->_readv(memaddr, &buff, 1);
 }
 
 
-int32_t FRAM32::readUntil(uint32_t memaddr, char * buf, uint16_t buflen, char separator)
+void FRAM::_sortSegments(FRAM_SEGMENT * segs, uint8_t cnt, uint8_t * order)
 {
-  //  read and fill the buffer at once.
-  this->read(memaddr, (uint8_t *)buf, buflen);
-  for (uint16_t length = 0; length < buflen; length++)
+  //  insertion sort, segments usually come in order
+  for (uint8_t i = 0; i < cnt; i++)
   {
-    if (buf[length] == separator)
+    uint8_t j = i;
+    while (j && segs[order[j - 1]].memaddr > segs[i].memaddr)
     {
-      buf[length] = 0;    //  replace separator => \0 EndChar
-      return length;
+      order[j] = order[j - 1];
+      j--;
     }
+    order[j] = i;
   }
-  //  entry does not fit in given buffer.
-  return (int32_t)-1;
 }
 
 
-int32_t FRAM32::readLine(uint32_t memaddr, char * buf, uint16_t buflen)
+void FRAM::_readv(uint32_t memaddr, i2c::ReadBuffer * buff, size_t cnt)
 {
-  //  read and fill the buffer at once.
-  this->read(memaddr, (uint8_t *)buf, buflen);
-  for (uint16_t length = 0; length < buflen-1; length++)
+  uint8_t devaddr = this->address_;
+  uint8_t maddr[2];
+  uint8_t len = this->_memoryAddress(memaddr, devaddr, maddr);
+  this->_wake();
+
+#ifdef USE_FRAM_STATS
+  uint32_t start = micros();
+#endif
+
+  i2c::ErrorCode err = this->bus_->write(devaddr, maddr, len, false);
+  if (err == i2c::ERROR_OK)
   {
-    if (buf[length] == '\n')
-    {
-      buf[length + 1] = 0;    //  add \0 EndChar after '\n'
-      return length + 1;
-    }
+    err = this->bus_->readv(devaddr, buff, cnt);
   }
-  //  entry does not fit in given buffer.
-  return (int32_t)-1;
-}
 
+#ifdef USE_FRAM_STATS
+  uint32_t size = 0;
+  for (size_t i = 0; i < cnt; i++) size += buff[i].len;
 
-template <class T> uint32_t FRAM32::writeObject(uint32_t memaddr, T &obj)
-{
-  this->write(memaddr, (uint8_t *) &obj, sizeof(obj));
-  return memaddr + sizeof(obj);
-};
+  this->_stats.reads++;
+  this->_stats.wire_cycles += wireCycles(len, size, true);
+  if (err == i2c::ERROR_OK) this->_stats.bytes_read += size;
+  this->_countTransaction(this->_stats.read_latency, this->_stats.read_us, micros() - start, err);
+#endif
+}
 
 
-template <class T> uint32_t FRAM32::readObject(uint32_t memaddr, T &obj)
+void FRAM::_writev(uint32_t memaddr, i2c::WriteBuffer * buff, size_t cnt)
 {
-  this->read(memaddr, (uint8_t *) &obj, sizeof(obj));
-  return memaddr + sizeof(obj);
+  uint8_t devaddr = this->address_;
+  uint8_t maddr[2];
+
+  buff[0].data = maddr;
+  buff[0].len = this->_memoryAddress(memaddr, devaddr, maddr);
+  this->_wake();
+
+#ifdef USE_FRAM_STATS
+  uint32_t start = micros();
+#endif
+
+  i2c::ErrorCode err = this->bus_->writev(devaddr, buff, cnt, true);
+
+#ifdef USE_FRAM_STATS
+  uint32_t size = 0;
+  for (size_t i = 1; i < cnt; i++) size += buff[i].len;
+
+  this->_stats.writes++;
+  this->_stats.wire_cycles += wireCycles(buff[0].len, size, false);
+  if (err == i2c::ERROR_OK) this->_stats.bytes_written += size;
+  this->_countTransaction(this->_stats.write_latency, this->_stats.write_us, micros() - start, err);
+#else
+  (void)err;
+#endif
 }
 
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//  FRAM32  PROTECTED
-//
-
-void FRAM32::_writeBlock(uint32_t memaddr, uint8_t * obj, uint8_t size)
+#ifdef USE_FRAM_STATS
+void FRAM::_countTransaction(uint32_t * histogram, uint32_t & total, uint32_t us, i2c::ErrorCode err)
 {
-  uint8_t _addr = this->address_;
-  if (memaddr & 0x00010000) _addr += 0x01;
-  
-  i2c::WriteBuffer buff[2];
-  uint8_t maddr[] = { (uint8_t)(memaddr >> 8), (uint8_t)(memaddr & 0xFF) };
+  if (err != i2c::ERROR_OK)
+  {
+    this->_stats.errors[std::min<uint8_t>(err, FRAM_STATS_ERRORS - 1)]++;
+  }
 
-  buff[0].data = maddr;
-  buff[0].len = 2;
-  buff[1].data = obj;
-  buff[1].len = size;
+  total += us;
 
-  this->bus_->writev(_addr, buff, 2, true);
+  //  bucket 0 < 128us, doubles up to the last one
+  uint8_t bucket = 0;
+  us >>= 7;
+  while (us && (bucket < FRAM_STATS_BUCKETS - 1))
+  {
+    us >>= 1;
+    bucket++;
+  }
+  histogram[bucket]++;
 }
+#endif
 
 
-void FRAM32::_readBlock(uint32_t memaddr, uint8_t * obj, uint8_t size)
+//  largest transfer from memaddr, at most _maxTransfer and not past the page end,
+//  the device would wrap to the start of the same page
+uint32_t FRAM::_blockSize(uint32_t memaddr, uint32_t size)
 {
-  uint8_t _addr = this->address_;
-  if (memaddr & 0x00010000) _addr += 0x01;
-
-  uint8_t maddr[] = { (uint8_t)(memaddr >> 8), (uint8_t)(memaddr & 0xFF) };
-  this->bus_->write(this->address_, maddr, 2, false);
-  this->bus_->read(_addr, obj, size);
+  uint32_t page = this->_pageSize();
+  uint32_t left = page - (memaddr & (page - 1));
+  return std::min<uint32_t>({size, this->_maxTransfer, left});
 }
 
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//  FRAM11
-//
+//  one device address covers 256 bytes with 1 address byte, 64KiB with 2
+uint32_t FRAM::_pageSize()
+{
+  return 1UL << (8 * this->_addressing.bytes);
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//  FRAM11  PROTECTED
+//  FRAM_LINEREADER
 //
 
-void FRAM11::_writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+FRAM_LINEREADER::FRAM_LINEREADER(FRAM * fram, uint32_t memaddr, uint32_t end)
 {
-  // Device uses Address Pages
-  uint8_t DeviceAddrWithPageBits = this->address_ | ((memaddr & 0x0700) >> 8);
+  this->_fram = fram;
+  this->_position = memaddr;
+  this->_end = end ? end : fram->getSizeBytes();
+}
 
-  i2c::WriteBuffer buff[2];
-  uint8_t maddr = memaddr & 0xFF;
 
-  buff[0].data = &maddr;
-  buff[0].len = 1;
-  buff[1].data = obj;
-  buff[1].len = size;
-
-  this->bus_->writev(DeviceAddrWithPageBits, buff, 2, true);
+int32_t FRAM_LINEREADER::readUntil(char * buf, uint16_t buflen, char separator)
+{
+  int32_t length = this->_scan(buf, buflen, separator);
+  if (length >= 0)
+  {
+    buf[length] = 0;    //  replace separator => \0 EndChar
+  }
+  return length;
 }
 
 
-void FRAM11::_readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+int32_t FRAM_LINEREADER::readLine(char * buf, uint16_t buflen)
 {
-  // Device uses Address Pages
-  uint8_t DeviceAddrWithPageBits = this->address_ | ((memaddr & 0x0700) >> 8);
-  uint8_t maddr = memaddr & 0xFF;
-
-  this->bus_->write(DeviceAddrWithPageBits, &maddr, 1, false);
-  this->bus_->read(DeviceAddrWithPageBits, obj, size);
+  if (buflen == 0) return (int32_t)-1;
+  int32_t length = this->_scan(buf, buflen - 1, '\n');
+  if (length >= 0)
+  {
+    buf[length + 1] = 0;    //  add \0 EndChar after '\n'
+    return length + 1;
+  }
+  return length;
 }
 
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//  FRAM9
-//
+void FRAM_LINEREADER::seek(uint32_t memaddr)
+{
+  this->_position = memaddr;
+  this->_head = 0;
+  this->_tail = 0;
+}
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//  FRAM9  PROTECTED
-//
 
-void FRAM9::_writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+int32_t FRAM_LINEREADER::_scan(char * buf, uint16_t limit, char separator)
 {
-  // Device uses Address Pages
-  uint8_t DeviceAddrWithPageBits = this->address_ | ((memaddr & 0x0100) >> 8);
+  uint32_t start = this->_position;
+  uint16_t length = 0;
+  while (length < limit)
+  {
+    if ((this->_head == this->_tail) && !this->_fill()) break;
 
-  i2c::WriteBuffer buff[2];
-  uint8_t maddr = memaddr & 0xFF;
+    uint16_t n = std::min<uint16_t>(this->_tail - this->_head, limit - length);
+    int32_t pos = findByte(this->_buffer + this->_head, n, separator);
+    uint16_t take = (pos < 0) ? n : (pos + 1);
 
-  buff[0].data = &maddr;
-  buff[0].len = 1;
-  buff[1].data = obj;
-  buff[1].len = size;
+    memcpy(buf + length, this->_buffer + this->_head, take);
+    this->_head += take;
+    this->_position += take;
+    length += take;
 
-  this->bus_->writev(DeviceAddrWithPageBits, buff, 2, true);
+    if (pos >= 0) return length - 1;
+  }
+  //  not found, start over next time
+  this->seek(start);
+  return (int32_t)-1;
 }
 
 
-void FRAM9::_readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size)
+bool FRAM_LINEREADER::_fill()
 {
-  // Device uses Address Pages
-  uint8_t DeviceAddrWithPageBits = this->address_ | ((memaddr & 0x0100) >> 8);
-  uint8_t maddr = memaddr & 0xFF;
-
-  this->bus_->write(DeviceAddrWithPageBits, &maddr, 1, false);
-  this->bus_->read(DeviceAddrWithPageBits, obj, size);
+  uint32_t size = FRAM_LINEREADER_BUFFER;
+  if (this->_end)
+  {
+    if (this->_position >= this->_end) return false;
+    size = std::min<uint32_t>(size, this->_end - this->_position);
+  }
+  this->_fram->_read(this->_position, this->_buffer, size);
+  this->_head = 0;
+  this->_tail = size;
+  return true;
 }
 
 
@@ -9,57 +9,188 @@
 //
 // ESPHome port: https://github.com/sharkydog/esphome-fram
 
+#include "esphome/core/defines.h"
 #include "esphome/core/hal.h"
 #include "esphome/core/log.h"
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/i2c/i2c.h"
+#include <functional>
+#include <vector>
+
+#ifdef USE_FRAM_ASYNC
+#include <mutex>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#endif
 
 namespace esphome {
 namespace fram {
 
+//  first block size for readUntil/readLine, doubles up to max_transfer
+const uint8_t FRAM_SCAN_BLOCK = 16;
+//  read ahead buffer of FRAM_LINEREADER
+const uint8_t FRAM_LINEREADER_BUFFER = 64;
+//  fill() repeats a pattern of this size, up to FRAM_FILL_REPEAT times per transaction
+const uint8_t FRAM_FILL_PATTERN = 64;
+const uint8_t FRAM_FILL_REPEAT = 16;
+
+//  write buffer line, FRAM_WB_LINE bits in dirty
+const uint8_t FRAM_WB_LINE = 32;
+//  max lines merged in one flush transaction
+const uint8_t FRAM_WB_SEGMENTS = 16;
+
+struct FRAM_WBLINE {
+  uint32_t addr;
+  uint32_t dirty;
+  uint8_t  data[FRAM_WB_LINE];
+};
+
+//  read cache associativity, lines per set
+const uint8_t FRAM_CACHE_WAYS = 2;
+
+//  progress of long operations, bytes done of total
+using FRAMProgress = std::function<void(uint32_t done, uint32_t total)>;
+
+#ifdef USE_FRAM_STATS
+//  latency histogram, first bucket < 128us, then doubling
+const uint8_t FRAM_STATS_BUCKETS = 8;
+//  indexed by i2c::ErrorCode
+const uint8_t FRAM_STATS_ERRORS = 8;
+
+struct FRAM_STATS {
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t bytes_read;
+  uint32_t bytes_written;
+  uint32_t read_us;
+  uint32_t write_us;
+  //  bus clock cycles, divide by bus frequency for time on the wire
+  uint32_t wire_cycles;
+  uint32_t errors[FRAM_STATS_ERRORS];
+  uint32_t read_latency[FRAM_STATS_BUCKETS];
+  uint32_t write_latency[FRAM_STATS_BUCKETS];
+};
+#endif
+
+//  staging buffer for startCopy()
+const uint8_t FRAM_COPY_BLOCK = 128;
+
+//  segment of readv()/writev()
+struct FRAM_SEGMENT {
+  uint32_t memaddr;
+  uint8_t * obj;
+  uint16_t size;
+};
+//  segments merged in one transaction
+const uint8_t FRAM_VECTOR_MAX = 16;
+
+//  compressed blobs, LZSS as heatshrink: flag bit, then a literal byte
+//  or a back reference of 8 bit distance and 4 bit length (2..17)
+const uint8_t FRAM_LZ_WINDOW_BITS = 8;
+const uint8_t FRAM_LZ_LENGTH_BITS = 4;
+const uint8_t FRAM_LZ_MIN_MATCH = 2;
+//  bus side buffer of the codec
+const uint8_t FRAM_LZ_BUFFER = 32;
+
+//  at the blob address, followed by stored bytes
+struct FRAM_BLOB {
+  uint32_t size;
+  uint32_t stored;
+};
+//  flag in stored, data did not compress and is kept as is
+const uint32_t FRAM_BLOB_RAW = 0x80000000;
+
+struct FRAM_OPERATION {
+  enum Type : uint8_t { NONE, READ, WRITE, FILL, COPY };
+  Type     type;
+  uint8_t  value;
+  uint32_t memaddr;
+  uint32_t from;
+  uint32_t size;
+  uint32_t done;
+  uint8_t * obj;
+  FRAMProgress progress;
+};
+
+#ifdef USE_FRAM_ASYNC
+struct FRAM_REQUEST {
+  enum Type : uint8_t { READ, WRITE, FILL };
+  Type     type;
+  uint8_t  value;
+  uint32_t memaddr;
+  uint32_t size;
+  uint8_t * obj;
+  std::function<void()> done;
+};
+#endif
+
+//  address layout of the FRAM types, a constant member set by the type.
+//  memory address bytes follow the device address, the bits above
+//  them go in the device address, masked by page_mask.
+struct FRAM_ADDRESSING {
+  uint8_t bytes;
+  uint8_t page_mask;
+};
+
+constexpr FRAM_ADDRESSING FRAM_ADDRESSING_16{2, 0x00};
+constexpr FRAM_ADDRESSING FRAM_ADDRESSING_17{2, 0x01};
+constexpr FRAM_ADDRESSING FRAM_ADDRESSING_11{1, 0x07};
+constexpr FRAM_ADDRESSING FRAM_ADDRESSING_9{1, 0x01};
+
 class FRAM : public Component, public i2c::I2CDevice
 {
 public:
+  FRAM(FRAM_ADDRESSING addressing = FRAM_ADDRESSING_16) : _addressing(addressing) {}
+
   void setup() override;
+  void loop() override;
   void dump_config() override;
+  void on_shutdown() override { this->flush(); }
   float get_setup_priority() const override { return setup_priority::BUS; }
 
   bool     isConnected();
+  //  members of a fram_volume on different buses transfer in parallel
+  i2c::I2CBus * getBus() { return this->bus_; };
 
-  void     write8(uint16_t memaddr, uint8_t value);
-  void     write16(uint16_t memaddr, uint16_t value);
-  void     write32(uint16_t memaddr, uint32_t value);
-  void     writeFloat(uint16_t memaddr, float value);
-  void     writeDouble(uint16_t memaddr, double value);
-  void     write(uint16_t memaddr, uint8_t * obj, uint16_t size);
+  //  addresses are 32 bit for all types, FRAM32 needs the 17th bit
+  void     write8(uint32_t memaddr, uint8_t value) { this->_writeValue(memaddr, value); };
+  void     write16(uint32_t memaddr, uint16_t value) { this->_writeValue(memaddr, value); };
+  void     write32(uint32_t memaddr, uint32_t value) { this->_writeValue(memaddr, value); };
+  void     writeFloat(uint32_t memaddr, float value) { this->_writeValue(memaddr, value); };
+  void     writeDouble(uint32_t memaddr, double value) { this->_writeValue(memaddr, value); };
+  void     write(uint32_t memaddr, uint8_t * obj, uint16_t size) { this->_write(memaddr, obj, size); };
 
-  uint8_t  read8(uint16_t memaddr);
-  uint16_t read16(uint16_t memaddr);
-  uint32_t read32(uint16_t memaddr);
-  float    readFloat(uint16_t memaddr);
-  double   readDouble(uint16_t memaddr);
-  void     read(uint16_t memaddr, uint8_t * obj, uint16_t size);
+  uint8_t  read8(uint32_t memaddr) { return this->_readValue<uint8_t>(memaddr); };
+  uint16_t read16(uint32_t memaddr) { return this->_readValue<uint16_t>(memaddr); };
+  uint32_t read32(uint32_t memaddr) { return this->_readValue<uint32_t>(memaddr); };
+  float    readFloat(uint32_t memaddr) { return this->_readValue<float>(memaddr); };
+  double   readDouble(uint32_t memaddr) { return this->_readValue<double>(memaddr); };
+  void     read(uint32_t memaddr, uint8_t * obj, uint16_t size) { this->_read(memaddr, obj, size); };
 
   //  Experimental 0.5.1
   //  readUntil returns length 0.. n of the buffer.
   //  readUntil does NOT include the separator character.
   //  readUntil returns -1 if data does not fit into buffer,
   //  =>  separator not encountered.
-  int32_t readUntil(uint16_t memaddr, char * buf, uint16_t buflen, char separator);
+  int32_t readUntil(uint32_t memaddr, char * buf, uint16_t buflen, char separator);
   //  readLine returns length 0.. n of the buffer.
   //  readLine does include '\n' as end character.
   //  readLine returns -1 if data does not fit into buffer.
   //  buffer needs one place for end char '\0'.
-  int32_t readLine(uint16_t memaddr, char * buf, uint16_t buflen);
+  int32_t readLine(uint32_t memaddr, char * buf, uint16_t buflen);
+  //  both read in small blocks and stop at the block holding the separator,
+  //  use FRAM_LINEREADER to walk consecutive lines.
 
-  template <class T> uint16_t writeObject(uint16_t memaddr, T &obj)
+  template <class T> uint32_t writeObject(uint32_t memaddr, T &obj)
   {
-    this->write(memaddr, (uint8_t *) &obj, sizeof(obj));
+    this->_write(memaddr, (uint8_t *) &obj, sizeof(obj));
     return memaddr + sizeof(obj);
   };
-  template <class T> uint16_t readObject(uint16_t memaddr, T &obj)
+  template <class T> uint32_t readObject(uint32_t memaddr, T &obj)
   {
-    this->read(memaddr, (uint8_t *) &obj, sizeof(obj));
+    this->_read(memaddr, (uint8_t *) &obj, sizeof(obj));
     return memaddr + sizeof(obj);
   }
 
@@ -76,23 +207,221 @@ public:
   //  override when getSize() fails == 0 (see readme.md)
   void     setSizeBytes(uint32_t value);
 
+  //  max bytes of data in one bus transaction, see max_transfer in readme.md
+  uint16_t getMaxTransfer() { return this->_maxTransfer; };
+  void     setMaxTransfer(uint16_t value) { if (value) this->_maxTransfer = value; };
+
+  //  write buffer, writes smaller than max_transfer and up to half
+  //  the buffer are merged in RAM
+  //  and written in loop() after flush_interval, on flush() or when full.
+  //  reads see buffered data.
+  void     setWriteBuffer(uint16_t size);
+  void     setFlushInterval(uint32_t ms) { this->_flushInterval = ms; };
+  void     flush();
+
+  //  read cache, reads up to line_size bytes go through it.
+  //  writes through this instance update it, invalidate() after
+  //  FRAM was changed by something else.
+  void     setReadCache(uint8_t line_size, uint16_t lines);
+  void     invalidate();
+  uint32_t getCacheHits() { return this->_cacheHits; };
+  uint32_t getCacheMisses() { return this->_cacheMisses; };
+
+  //  cooperative operations, loop() advances them for time_budget
+  //  and calls on_complete when done. one at a time, false if busy.
+  //  obj must stay valid until done, progress is called after every loop().
+  bool     startRead(uint32_t memaddr, uint8_t * obj, uint32_t size, FRAMProgress progress = nullptr);
+  bool     startWrite(uint32_t memaddr, uint8_t * obj, uint32_t size, FRAMProgress progress = nullptr);
+  bool     startFill(uint32_t memaddr, uint32_t len, uint8_t value = 0, FRAMProgress progress = nullptr);
+  bool     startClear(uint8_t value = 0, FRAMProgress progress = nullptr);
+  //  overlapping ranges are fine, like memmove()
+  bool     startCopy(uint32_t from, uint32_t to, uint32_t len, FRAMProgress progress = nullptr);
+  bool     isBusy() { return this->_operation.type != FRAM_OPERATION::NONE; };
+  //  percent done of the current or last operation
+  float    getProgress();
+  void     setTimeBudget(uint32_t us) { this->_timeBudget = us; };
+  void     add_on_complete_callback(std::function<void()> &&callback) { this->_onComplete.add(std::move(callback)); };
+
+#ifdef USE_FRAM_ASYNC
+  //  ESP32 only, see async in readme.md
+  //  queued to a worker task, done() is called from loop().
+  //  obj must stay valid until then. returns false if the queue is full.
+  //  sync calls do not wait for queued requests.
+  void     setAsync(uint8_t queue_size, uint8_t priority, int8_t core);
+  bool     readAsync(uint32_t memaddr, uint8_t * obj, uint32_t size, std::function<void()> && done = nullptr);
+  bool     writeAsync(uint32_t memaddr, uint8_t * obj, uint32_t size, std::function<void()> && done = nullptr);
+  bool     fillAsync(uint32_t memaddr, uint32_t len, uint8_t value = 0, std::function<void()> && done = nullptr);
+#endif
+
+#ifdef USE_FRAM_STATS
+  //  counted per bus transaction, see stats in readme.md
+  const FRAM_STATS & getStats() { return this->_stats; };
+  uint32_t getErrors();
+  void     resetStats();
+#endif
+
+  //  projected time on the wire in us for a read or write of size bytes,
+  //  from bus frequency, max_transfer and address bytes. no bus access.
+  uint32_t wireTime(uint32_t size, bool read = true);
+  void     setBusFrequency(uint32_t hz) { if (hz) this->_busFrequency = hz; };
+
   //  fills FRAM with value, default 0.
-  uint32_t clear(uint8_t value = 0);
+  uint32_t clear(uint8_t value = 0, FRAMProgress progress = nullptr);
+  //  fills len bytes from memaddr with value, returns bytes written.
+  //  progress is called after every transaction.
+  uint32_t fill(uint32_t memaddr, uint32_t len, uint8_t value = 0, FRAMProgress progress = nullptr);
+
+  //  scatter-gather, segments are taken in address order and adjacent
+  //  ones merged in one transaction, up to max_transfer within a page.
+  //  readv() also reads through holes up to the gap threshold.
+  //  segments must not overlap.
+  void     readv(FRAM_SEGMENT * segs, uint8_t cnt);
+  void     writev(FRAM_SEGMENT * segs, uint8_t cnt);
+  void     setGapThreshold(uint8_t bytes) { this->_gapThreshold = bytes; };
+  uint8_t  getGapThreshold() { return this->_gapThreshold; };
+
+  //  compressed blob at memaddr, returns FRAM bytes used with the header.
+  //  data that does not compress is stored as is.
+  uint32_t writeCompressed(uint32_t memaddr, const uint8_t * obj, uint32_t size);
+  //  returns blob size, -1 if it does not fit in buflen or is damaged.
+  //  decodes from small bus reads straight into obj.
+  int32_t  readCompressed(uint32_t memaddr, uint8_t * obj, uint32_t buflen);
+  //  blob size and FRAM bytes after the header, ratio is size / stored
+  bool     getBlobInfo(uint32_t memaddr, uint32_t & size, uint32_t & stored);
 
   //  0.3.6
   void sleep();
   //  trec <= 400us  P12
   bool wakeup(uint32_t trec = 400);
 
+  //  sleep in loop() after ms without bus access, 0 = off.
+  //  the next access wakes the chip and waits trec once,
+  //  calls in the same loop() run find it awake.
+  void     setAutoSleep(uint32_t ms, uint32_t trec = 400) { this->_autoSleep = ms; this->_trec = trec; };
+  bool     isAsleep() { return this->_asleep; };
+  uint32_t getSleeps() { return this->_sleeps; };
+  uint32_t getWakes() { return this->_wakes; };
+  //  ms asleep since boot
+  uint32_t getSleepTime();
+
 
 protected:
+  friend class FRAM_LINEREADER;
+
+  const FRAM_ADDRESSING _addressing;
   uint32_t _sizeBytes{0};
+  //  old fixed block size, yaml sets a platform default
+  uint16_t _maxTransfer{24};
+  //  i2c default, yaml sets the bus frequency
+  uint32_t _busFrequency{50000};
+  //  a hole costs less than a new address phase
+  uint8_t  _gapThreshold{4};
+
+  //  auto sleep
+  uint32_t _autoSleep{0};
+  uint32_t _trec{400};
+  bool     _asleep{false};
+  uint32_t _lastAccess{0};
+  uint32_t _sleepSince{0};
+  uint32_t _sleepTime{0};
+  uint32_t _sleeps{0};
+  uint32_t _wakes{0};
+  //  before every transaction
+  void     _wake();
+
+  std::vector<FRAM_WBLINE> _wbLines;
+  std::vector<FRAM_WBLINE *> _wbOrder;
+  uint32_t _flushInterval{0};
+  uint32_t _wbSince{0};
+  bool     _wbDirty{false};
+
+  //  _cacheTags holds the line address or FRAM_CACHE_EMPTY, set by set
+  std::vector<uint32_t> _cacheTags;
+  std::vector<uint8_t>  _cacheData;
+  std::vector<uint8_t>  _cacheNext;
+  uint16_t _cacheSets{0};
+  uint8_t  _cacheLineSize{0};
+  uint32_t _cacheHits{0};
+  uint32_t _cacheMisses{0};
+
+#ifdef USE_FRAM_STATS
+  FRAM_STATS _stats{};
+  void     _countTransaction(uint32_t * histogram, uint32_t & total, uint32_t us, i2c::ErrorCode err);
+#endif
+
+  FRAM_OPERATION _operation{};
+  uint32_t _timeBudget{2000};
+  CallbackManager<void()> _onComplete;
+
+  bool     _startOperation(const FRAM_OPERATION & op);
+  void     _operationStep();
+
+#ifdef USE_FRAM_ASYNC
+  std::recursive_mutex _lock;
+  QueueHandle_t _asyncQueue{nullptr};
+  QueueHandle_t _asyncDone{nullptr};
+  uint8_t  _asyncQueueSize{0};
+  uint8_t  _asyncPriority{5};
+  int8_t   _asyncCore{-1};
+  //  the task that runs setup() and loop()
+  TaskHandle_t _loopTask{nullptr};
+
+  bool     _asyncSubmit(FRAM_REQUEST * req);
+  static void _asyncTask(void * arg);
+#endif
 
   uint16_t _getMetaData(uint8_t id);
+  //  long transfers, only on the loop task
+  void     _feedWatchdog();
+
+  //  split in blocks by _blockSize(), through the write buffer
+  void     _write(uint32_t memaddr, uint8_t * obj, uint32_t size);
+  void     _read(uint32_t memaddr, uint8_t * obj, uint32_t size);
+
+  void     _bufferWrite(uint32_t memaddr, const uint8_t * obj, uint32_t size);
+  void     _bufferRead(uint32_t memaddr, uint8_t * obj, uint32_t size);
+  //  drop buffered bytes about to be overwritten
+  void     _bufferDiscard(uint32_t memaddr, uint32_t size);
+
+  void     _readBlocks(uint32_t memaddr, uint8_t * obj, uint32_t size);
+  void     _cacheRead(uint32_t memaddr, uint8_t * obj, uint32_t size);
+  //  updates cached lines, obj == nullptr drops them instead
+  void     _cacheWrite(uint32_t memaddr, const uint8_t * obj, uint32_t size);
+
+  //  returns index of separator in buf or -1, reads at most limit bytes
+  int32_t  _readUntil(uint32_t memaddr, char * buf, uint16_t limit, char separator);
 
-  //  virtual so derived classes FRAM9/11 use their implementation.
-  virtual void _writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
-  virtual void _readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
+  void     _writeBlock(uint32_t memaddr, uint8_t * obj, uint16_t size);
+  void     _readBlock(uint32_t memaddr, uint8_t * obj, uint16_t size);
+  //  transfer planning, blocks never cross a page (device address)
+  uint32_t _blockSize(uint32_t memaddr, uint32_t size);
+  uint32_t _pageSize();
+  //  segment indexes in address order
+  void     _sortSegments(FRAM_SEGMENT * segs, uint8_t cnt, uint8_t * order);
+  //  one read transaction into several buffers
+  void     _readv(uint32_t memaddr, i2c::ReadBuffer * buff, size_t cnt);
+  //  buff[0] is set to the memory address, data follows in buff[1..cnt-1]
+  void     _writev(uint32_t memaddr, i2c::WriteBuffer * buff, size_t cnt);
+
+  //  puts page bits in devaddr if needed, returns bytes written to maddr.
+  uint8_t  _memoryAddress(uint32_t memaddr, uint8_t & devaddr, uint8_t * maddr)
+  {
+    devaddr |= (memaddr >> (8 * this->_addressing.bytes)) & this->_addressing.page_mask;
+    if (this->_addressing.bytes == 2) *maddr++ = (uint8_t)(memaddr >> 8);
+    *maddr = (uint8_t)(memaddr & 0xFF);
+    return this->_addressing.bytes;
+  };
+
+  template <class T> void _writeValue(uint32_t memaddr, T value)
+  {
+    this->_write(memaddr, (uint8_t *) &value, sizeof(T));
+  };
+  template <class T> T _readValue(uint32_t memaddr)
+  {
+    T value;
+    this->_read(memaddr, (uint8_t *) &value, sizeof(T));
+    return value;
+  };
 };
 
 
@@ -104,33 +433,7 @@ protected:
 class FRAM32 : public FRAM
 {
 public:
-  void     write8(uint32_t memaddr, uint8_t value);
-  void     write16(uint32_t memaddr, uint16_t value);
-  void     write32(uint32_t memaddr, uint32_t value);
-  void     writeFloat(uint32_t memaddr, float value);
-  void     writeDouble(uint32_t memaddr, double value);
-  void     write(uint32_t memaddr, uint8_t * obj, uint16_t size);
-
-  uint8_t  read8(uint32_t memaddr);
-  uint16_t read16(uint32_t memaddr);
-  uint32_t read32(uint32_t memaddr);
-  float    readFloat(uint32_t memaddr);
-  double   readDouble(uint32_t memaddr);
-  void     read(uint32_t memaddr, uint8_t * obj, uint16_t size);
-
-  //  readUntil returns length 0.. n of the buffer.
-  //  readUntil returns -1 if data does not fit into buffer,
-  //  =>  separator not encountered.
-  int32_t readUntil(uint32_t memaddr, char * buf, uint16_t buflen, char separator);
-  //  buffer needs one place for end char '\0'.
-  int32_t readLine(uint32_t memaddr, char * buf, uint16_t buflen);
-
-  template <class T> uint32_t writeObject(uint32_t memaddr, T &obj);
-  template <class T> uint32_t readObject(uint32_t memaddr, T &obj);
-
-protected:
-  void     _writeBlock(uint32_t memaddr, uint8_t * obj, uint8_t size);
-  void     _readBlock(uint32_t memaddr, uint8_t * obj, uint8_t size);
+  FRAM32() : FRAM(FRAM_ADDRESSING_17) {}
 };
 
 
@@ -141,9 +444,8 @@ protected:
 
 class FRAM11 : public FRAM
 {
-protected:
-  void     _writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
-  void     _readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
+public:
+  FRAM11() : FRAM(FRAM_ADDRESSING_11) {}
 };
 
 
@@ -153,9 +455,47 @@ protected:
 //
 class FRAM9 : public FRAM
 {
+public:
+  FRAM9() : FRAM(FRAM_ADDRESSING_9) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//  FRAM_LINEREADER  cursor over consecutive lines or separated records
+//
+//  bytes read past a separator are kept for the next call,
+//  so a block of lines is read from the device only once.
+//  works with all FRAM types, addresses are 32 bit.
+//
+
+class FRAM_LINEREADER
+{
+public:
+  //  end == 0  =>  size of the device, or unlimited if size is unknown
+  FRAM_LINEREADER(FRAM * fram, uint32_t memaddr = 0, uint32_t end = 0);
+
+  //  same return values as FRAM::readUntil() and FRAM::readLine()
+  //  on -1 the position does not move.
+  int32_t  readUntil(char * buf, uint16_t buflen, char separator);
+  int32_t  readLine(char * buf, uint16_t buflen);
+
+  uint32_t position() { return this->_position; };
+  void     seek(uint32_t memaddr);
+  bool     eof() { return this->_end && (this->_position >= this->_end); };
+
 protected:
-  void     _writeBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
-  void     _readBlock(uint16_t memaddr, uint8_t * obj, uint8_t size);
+  FRAM *   _fram;
+  uint32_t _position;
+  uint32_t _end;
+
+  //  _buffer[_head.._tail) holds the bytes at _position
+  uint8_t  _buffer[FRAM_LINEREADER_BUFFER];
+  uint8_t  _head{0};
+  uint8_t  _tail{0};
+
+  int32_t  _scan(char * buf, uint16_t limit, char separator);
+  bool     _fill();
 };
 
 }  // namespace fram
@@ -0,0 +1,60 @@
+#include "FRAM_SENSOR.h"
+
+#ifdef USE_FRAM_SENSOR
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace fram {
+
+static const char * const TAG = "fram.sensor";
+
+static float average(uint32_t time, uint32_t timeLast, uint32_t count, uint32_t countLast)
+{
+  if (count == countLast) {
+    return NAN;
+  }
+  return (float)(time - timeLast) / (count - countLast);
+}
+
+void FRAM_SENSOR::update()
+{
+  const FRAM_STATS & st = this->_fram->getStats();
+
+  if (this->_bytesRead != nullptr) {
+    this->_bytesRead->publish_state(st.bytes_read);
+  }
+  if (this->_bytesWritten != nullptr) {
+    this->_bytesWritten->publish_state(st.bytes_written);
+  }
+  if (this->_transactions != nullptr) {
+    this->_transactions->publish_state(st.reads + st.writes);
+  }
+  if (this->_errors != nullptr) {
+    this->_errors->publish_state(this->_fram->getErrors());
+  }
+  if (this->_readLatency != nullptr) {
+    this->_readLatency->publish_state(average(st.read_us, this->_last.read_us, st.reads, this->_last.reads));
+  }
+  if (this->_writeLatency != nullptr) {
+    this->_writeLatency->publish_state(average(st.write_us, this->_last.write_us, st.writes, this->_last.writes));
+  }
+
+  this->_last = st;
+}
+
+void FRAM_SENSOR::dump_config()
+{
+  ESP_LOGCONFIG(TAG, "FRAM_SENSOR:");
+  LOG_SENSOR("  ", "Bytes read", this->_bytesRead);
+  LOG_SENSOR("  ", "Bytes written", this->_bytesWritten);
+  LOG_SENSOR("  ", "Transactions", this->_transactions);
+  LOG_SENSOR("  ", "Errors", this->_errors);
+  LOG_SENSOR("  ", "Read latency", this->_readLatency);
+  LOG_SENSOR("  ", "Write latency", this->_writeLatency);
+}
+
+}  // namespace fram
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_FRAM_SENSOR
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "FRAM.h"
+
+namespace esphome {
+namespace fram {
+
+class FRAM_SENSOR : public PollingComponent
+{
+public:
+  FRAM_SENSOR(FRAM * fram) : _fram(fram) {}
+
+  void setBytesReadSensor(sensor::Sensor * sens) { this->_bytesRead = sens; };
+  void setBytesWrittenSensor(sensor::Sensor * sens) { this->_bytesWritten = sens; };
+  void setTransactionsSensor(sensor::Sensor * sens) { this->_transactions = sens; };
+  void setErrorsSensor(sensor::Sensor * sens) { this->_errors = sens; };
+  void setReadLatencySensor(sensor::Sensor * sens) { this->_readLatency = sens; };
+  void setWriteLatencySensor(sensor::Sensor * sens) { this->_writeLatency = sens; };
+
+  void update() override;
+  void dump_config() override;
+
+protected:
+  FRAM *           _fram;
+  sensor::Sensor * _bytesRead{nullptr};
+  sensor::Sensor * _bytesWritten{nullptr};
+  sensor::Sensor * _transactions{nullptr};
+  sensor::Sensor * _errors{nullptr};
+  sensor::Sensor * _readLatency{nullptr};
+  sensor::Sensor * _writeLatency{nullptr};
+
+  //  previous update, latency is the average since then
+  FRAM_STATS       _last{};
+};
+
+}  // namespace fram
+}  // namespace esphome
+
+#endif
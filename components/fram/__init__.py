@@ -1,17 +1,35 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 import re
+from esphome import automation
 from esphome.components import i2c
-from esphome.const import CONF_ID, CONF_TYPE, CONF_SIZE
+from esphome.const import CONF_ID, CONF_TYPE, CONF_SIZE, CONF_TRIGGER_ID, CONF_FREQUENCY, CONF_I2C_ID
+from esphome.core import CORE
 
 DEPENDENCIES = ["i2c"]
 MULTI_CONF = True
+CONF_MAX_TRANSFER = "max_transfer"
+CONF_WRITE_BUFFER = "write_buffer"
+CONF_FLUSH_INTERVAL = "flush_interval"
+CONF_READ_CACHE = "read_cache"
+CONF_LINE_SIZE = "line_size"
+CONF_LINES = "lines"
+CONF_ASYNC = "async"
+CONF_QUEUE_SIZE = "queue_size"
+CONF_TASK_PRIORITY = "task_priority"
+CONF_TASK_CORE = "task_core"
+CONF_TIME_BUDGET = "time_budget"
+CONF_ON_COMPLETE = "on_complete"
+CONF_STATS = "stats"
+CONF_AUTO_SLEEP_AFTER = "auto_sleep_after"
+CONF_GAP_THRESHOLD = "gap_threshold"
 
 fram_ns = cg.esphome_ns.namespace("fram")
 FRAMComponent = fram_ns.class_("FRAM", cg.Component, i2c.I2CDevice)
 FRAM9Component = fram_ns.class_("FRAM9", FRAMComponent)
 FRAM11Component = fram_ns.class_("FRAM11", FRAMComponent)
 FRAM32Component = fram_ns.class_("FRAM32", FRAMComponent)
+OperationCompleteTrigger = fram_ns.class_("OperationCompleteTrigger", automation.Trigger.template())
 
 def validate_bytes_1024(value):
     value = cv.string(value).lower()
@@ -35,9 +53,34 @@ def validate_bytes_1024(value):
 
     return int(int(match.group(1)) * SUFF[match.group(2)])
 
+def validate_even(value):
+    if value % 2:
+        raise cv.Invalid(f"Expected an even number, got {value}")
+    return value
+
 
 FRAM_SCHEMA = cv.Schema({
-    cv.Optional(CONF_SIZE): validate_bytes_1024
+    cv.Optional(CONF_SIZE): validate_bytes_1024,
+    # Wire buffer on arduino is 128 bytes, 2 of them go for the memory address
+    cv.SplitDefault(CONF_MAX_TRANSFER, esp8266=126, esp32_arduino=126, esp32_idf=1024, rp2040=126): cv.int_range(min=1,max=65535),
+    cv.Optional(CONF_WRITE_BUFFER): cv.All(validate_bytes_1024, cv.int_range(min=32,max=8192)),
+    cv.Optional(CONF_FLUSH_INTERVAL, default="0ms"): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_READ_CACHE): cv.Schema({
+        cv.Optional(CONF_LINE_SIZE, default=16): cv.one_of(8, 16, 32, 64, 128, int=True),
+        cv.Optional(CONF_LINES, default=16): cv.All(cv.int_range(min=2,max=256), validate_even)
+    }),
+    cv.Optional(CONF_ASYNC): cv.All(cv.Schema({
+        cv.Optional(CONF_QUEUE_SIZE, default=8): cv.int_range(min=1,max=64),
+        cv.Optional(CONF_TASK_PRIORITY, default=5): cv.int_range(min=1,max=24),
+        cv.Optional(CONF_TASK_CORE): cv.int_range(min=0,max=1)
+    }), cv.only_on_esp32),
+    cv.Optional(CONF_STATS, default=False): cv.boolean,
+    cv.Optional(CONF_AUTO_SLEEP_AFTER): cv.positive_not_null_time_period,
+    cv.Optional(CONF_GAP_THRESHOLD, default=4): cv.int_range(min=0,max=255),
+    cv.Optional(CONF_TIME_BUDGET, default="2ms"): cv.positive_time_period_microseconds,
+    cv.Optional(CONF_ON_COMPLETE): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(OperationCompleteTrigger)
+    })
 }).extend(cv.COMPONENT_SCHEMA).extend(i2c.i2c_device_schema(0x50))
 
 CONFIG_SCHEMA = cv.typed_schema({
@@ -60,5 +103,38 @@ async def to_code(config):
     await cg.register_component(var, config)
     await i2c.register_i2c_device(var, config)
 
+    cg.add(var.setTimeBudget(config[CONF_TIME_BUDGET]))
+    cg.add(var.setGapThreshold(config[CONF_GAP_THRESHOLD]))
+
+    for conf in CORE.config.get("i2c", []):
+        if conf[CONF_ID] == config[CONF_I2C_ID]:
+            cg.add(var.setBusFrequency(int(conf[CONF_FREQUENCY])))
+
+    if config[CONF_STATS]:
+        cg.add_define("USE_FRAM_STATS")
+
+    for conf in config.get(CONF_ON_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [], conf)
+
     if CONF_SIZE in config:
-        cg.add(var.setSizeBytes(config[CONF_SIZE]))
\ No newline at end of file
+        cg.add(var.setSizeBytes(config[CONF_SIZE]))
+
+    if CONF_MAX_TRANSFER in config:
+        cg.add(var.setMaxTransfer(config[CONF_MAX_TRANSFER]))
+
+    if CONF_AUTO_SLEEP_AFTER in config:
+        cg.add(var.setAutoSleep(config[CONF_AUTO_SLEEP_AFTER].total_milliseconds))
+
+    if CONF_WRITE_BUFFER in config:
+        cg.add(var.setWriteBuffer(config[CONF_WRITE_BUFFER]))
+        cg.add(var.setFlushInterval(config[CONF_FLUSH_INTERVAL]))
+
+    if CONF_READ_CACHE in config:
+        conf = config[CONF_READ_CACHE]
+        cg.add(var.setReadCache(conf[CONF_LINE_SIZE], conf[CONF_LINES]))
+
+    if CONF_ASYNC in config:
+        conf = config[CONF_ASYNC]
+        cg.add_define("USE_FRAM_ASYNC")
+        cg.add(var.setAsync(conf[CONF_QUEUE_SIZE], conf[CONF_TASK_PRIORITY], conf.get(CONF_TASK_CORE, -1)))
\ No newline at end of file
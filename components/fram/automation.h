@@ -0,0 +1,17 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "FRAM.h"
+
+namespace esphome {
+namespace fram {
+
+class OperationCompleteTrigger : public Trigger<> {
+  public:
+    explicit OperationCompleteTrigger(FRAM * parent) {
+      parent->add_on_complete_callback([this]() { this->trigger(); });
+    }
+};
+
+}  // namespace fram
+}  // namespace esphome
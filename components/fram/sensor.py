@@ -0,0 +1,59 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import CONF_ID, STATE_CLASS_MEASUREMENT, STATE_CLASS_TOTAL_INCREASING
+from . import fram_ns, FRAMComponent
+
+DEPENDENCIES = ["fram"]
+CONF_FRAM_ID = "fram_id"
+CONF_BYTES_READ = "bytes_read"
+CONF_BYTES_WRITTEN = "bytes_written"
+CONF_TRANSACTIONS = "transactions"
+CONF_ERRORS = "errors"
+CONF_READ_LATENCY = "read_latency"
+CONF_WRITE_LATENCY = "write_latency"
+
+FRAMSensorComponent = fram_ns.class_("FRAM_SENSOR", cg.PollingComponent)
+
+COUNTER_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="B",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING
+)
+
+LATENCY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="µs",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT
+)
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.declare_id(FRAMSensorComponent),
+    cv.GenerateID(CONF_FRAM_ID): cv.use_id(FRAMComponent),
+    cv.Optional(CONF_BYTES_READ): COUNTER_SCHEMA,
+    cv.Optional(CONF_BYTES_WRITTEN): COUNTER_SCHEMA,
+    cv.Optional(CONF_TRANSACTIONS): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING
+    ),
+    cv.Optional(CONF_ERRORS): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING
+    ),
+    cv.Optional(CONF_READ_LATENCY): LATENCY_SCHEMA,
+    cv.Optional(CONF_WRITE_LATENCY): LATENCY_SCHEMA
+}).extend(cv.polling_component_schema("60s"))
+
+async def to_code(config):
+    fram = await cg.get_variable(config[CONF_FRAM_ID])
+
+    var = cg.new_Pvariable(config[CONF_ID], fram)
+    await cg.register_component(var, config)
+    cg.add_define("USE_FRAM_STATS")
+    cg.add_define("USE_FRAM_SENSOR")
+
+    for key in [CONF_BYTES_READ, CONF_BYTES_WRITTEN, CONF_TRANSACTIONS, CONF_ERRORS, CONF_READ_LATENCY, CONF_WRITE_LATENCY]:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            setter = "set" + "".join(w.capitalize() for w in key.split("_")) + "Sensor"
+            cg.add(getattr(var, setter)(sens))
@@ -0,0 +1,493 @@
+#include "FRAM_KV.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+
+namespace esphome {
+namespace fram_kv {
+
+static const char * const TAG = "fram_kv";
+static const uint32_t FRAM_KV_EMPTY = 0xFFFFFFFF;
+static const uint32_t FRAM_KV_TOMB = 0xFFFFFFFE;
+//  boot scan reads the log in blocks of this size
+static const uint16_t FRAM_KV_SCAN_BLOCK = 512;
+
+
+void FRAM_KV::setRegion(uint32_t memaddr, uint32_t size)
+{
+  this->_start = memaddr;
+  this->_size = size - FRAM_KV_HEADER_SIZE;
+}
+
+
+void FRAM_KV::setup()
+{
+  //  at most 3/4 full
+  uint32_t slots = 4;
+  while (slots * 3 < this->_maxKeys * 4u + 4) slots <<= 1;
+  this->_index.assign(slots, FRAM_KV_SLOT{FRAM_KV_EMPTY, 0, 0});
+
+  if (!this->_scan())
+  {
+    ESP_LOGW(TAG, "No valid log at 0x%x, starting empty", this->_start);
+    this->wipe();
+  }
+}
+
+
+void FRAM_KV::loop()
+{
+  //  compact while dead entries take an 1/8 of the log,
+  //  put() compacts when there is no room
+  for (uint8_t i = 0; i < FRAM_KV_COMPACT_STEP; i++)
+  {
+    if (this->_dead < this->_size / 8) break;
+    if (!this->_compactStep()) break;
+  }
+}
+
+
+void FRAM_KV::dump_config()
+{
+  ESP_LOGCONFIG(TAG, "FRAM key-value store:");
+  ESP_LOGCONFIG(TAG, "  Region: %u - %u", this->_start, this->_start + FRAM_KV_HEADER_SIZE + this->_size - 1);
+  ESP_LOGCONFIG(TAG, "  Keys: %u of %u, index: %u bytes", this->_count, this->_maxKeys,
+    (unsigned)(this->_index.size() * sizeof(FRAM_KV_SLOT)));
+  ESP_LOGCONFIG(TAG, "  Free: %u bytes, dead: %u bytes", this->free(), this->_dead);
+}
+
+
+bool FRAM_KV::put(const std::string & key, const uint8_t * value, uint16_t size)
+{
+  if (key.empty() || key.size() > 255) return false;
+
+  uint32_t entry = sizeof(FRAM_KV_ENTRY) + key.size() + size;
+  int32_t slot = this->_find(key);
+  if (slot < 0 && this->_count >= this->_maxKeys) return false;
+
+  //  compaction needs room to move the largest entry after this one,
+  //  two of them as free space can be split by the end of the log.
+  //  may move entries, slots stay in place
+  uint32_t spare = 2 * (std::max(this->_maxEntry, entry) + 1);
+  if (!this->_reserve(entry, spare)) return false;
+  this->_maxEntry = std::max(this->_maxEntry, entry);
+
+  uint32_t pos = this->_tail;
+  this->_append(key, value, size);
+
+  if (slot >= 0)
+  {
+    FRAM_KV_SLOT & s = this->_index[slot];
+    this->_kill(s.pos, sizeof(FRAM_KV_ENTRY) + key.size() + s.value_len);
+    s.pos = pos;
+    s.value_len = size;
+  }
+  else
+  {
+    this->_insert(this->_hash(key.data(), key.size()), pos, size);
+  }
+  return true;
+}
+
+
+int32_t FRAM_KV::get(const std::string & key, uint8_t * value, uint16_t buflen)
+{
+  if (key.empty() || key.size() > 255) return -1;
+
+  uint32_t mask = this->_index.size() - 1;
+  uint16_t hash = this->_hash(key.data(), key.size());
+  uint8_t  buffer[FRAM_KV_READ_BUFFER];
+
+  for (uint32_t i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++)
+  {
+    FRAM_KV_SLOT & s = this->_index[i];
+    if (s.pos == FRAM_KV_EMPTY) return -1;
+    if (s.pos == FRAM_KV_TOMB || s.hash != hash) continue;
+
+    //  key and value in one read when they fit in the buffer
+    uint32_t head = sizeof(FRAM_KV_ENTRY) + key.size();
+    if ((s.value_len <= buflen) && (head + s.value_len <= FRAM_KV_READ_BUFFER))
+    {
+      this->_fram->read(this->_addr(s.pos), buffer, head + s.value_len);
+      if (buffer[1] != key.size() || memcmp(buffer + sizeof(FRAM_KV_ENTRY), key.data(), key.size())) continue;
+      memcpy(value, buffer + head, s.value_len);
+      return s.value_len;
+    }
+
+    if (!this->_keyAt(s.pos, key)) continue;
+    if (s.value_len > buflen) return -1;
+    this->_fram->read(this->_addr(s.pos + head), value, s.value_len);
+    return s.value_len;
+  }
+  return -1;
+}
+
+
+bool FRAM_KV::erase(const std::string & key)
+{
+  int32_t slot = this->_find(key);
+  if (slot < 0) return false;
+
+  FRAM_KV_SLOT & s = this->_index[slot];
+  this->_kill(s.pos, sizeof(FRAM_KV_ENTRY) + key.size() + s.value_len);
+  s.pos = FRAM_KV_TOMB;
+  this->_count--;
+  this->_tombs++;
+  return true;
+}
+
+
+uint32_t FRAM_KV::free()
+{
+  uint32_t used = (this->_tail >= this->_head) ?
+    this->_tail - this->_head : this->_size - this->_head + this->_tail;
+  //  one byte for END
+  return this->_size - used - 1;
+}
+
+
+void FRAM_KV::wipe()
+{
+  std::fill(this->_index.begin(), this->_index.end(), FRAM_KV_SLOT{FRAM_KV_EMPTY, 0, 0});
+  this->_tombs = 0;
+  this->_count = 0;
+  this->_dead = 0;
+  this->_head = 0;
+  this->_tail = 0;
+  this->_fram->write8(this->_addr(0), FRAM_KV_END);
+  this->_saveHead();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// FRAM_KV PROTECTED
+//
+
+//  FNV-1a folded to 16 bits, stored in the slot and used to pick it
+uint32_t FRAM_KV::_hash(const char * key, uint8_t len)
+{
+  uint32_t hash = 0x811C9DC5;
+  for (uint8_t i = 0; i < len; i++)
+  {
+    hash = (hash ^ (uint8_t)key[i]) * 0x01000193;
+  }
+  return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+
+//  changes with the region size, an old log is not loaded
+uint32_t FRAM_KV::_magic()
+{
+  return 0x4B560000UL ^ this->_size;
+}
+
+
+void FRAM_KV::_saveHead()
+{
+  uint32_t header[3] = {this->_magic(), this->_head, ~this->_head};
+  this->_fram->write(this->_start, (uint8_t *)header, sizeof(header));
+}
+
+
+//  one pass from head to END, in blocks
+bool FRAM_KV::_scan()
+{
+  uint32_t header[3];
+  this->_fram->read(this->_start, (uint8_t *)header, sizeof(header));
+  if (header[0] != this->_magic() || header[1] != ~header[2] || header[1] >= this->_size) return false;
+
+  std::vector<uint8_t> buffer(FRAM_KV_SCAN_BLOCK);
+  uint32_t bufPos = 0;
+  uint32_t bufLen = 0;
+  auto at = [&](uint32_t pos, uint32_t len) -> uint8_t * {
+    if (pos < bufPos || pos + len > bufPos + bufLen)
+    {
+      bufPos = pos;
+      bufLen = std::min((uint32_t)FRAM_KV_SCAN_BLOCK, this->_size - pos);
+      this->_fram->read(this->_addr(pos), buffer.data(), bufLen);
+    }
+    return buffer.data() + (pos - bufPos);
+  };
+
+  this->_head = header[1];
+  uint32_t pos = this->_head;
+  bool wrapped = false;
+
+  while (true)
+  {
+    uint8_t state = *at(pos, 1);
+
+    if (state == FRAM_KV_END) break;
+
+    if (state == FRAM_KV_WRAP && !wrapped && pos >= this->_head)
+    {
+      this->_dead += this->_size - pos;
+      wrapped = true;
+      pos = 0;
+      continue;
+    }
+
+    if ((state != FRAM_KV_LIVE && state != FRAM_KV_DEAD) || pos + sizeof(FRAM_KV_ENTRY) + 1 > this->_size)
+    {
+      ESP_LOGW(TAG, "Bad entry at %u, log truncated", pos);
+      break;
+    }
+
+    FRAM_KV_ENTRY entry;
+    memcpy(&entry, at(pos, sizeof(entry)), sizeof(entry));
+    uint32_t size = sizeof(entry) + entry.key_len + entry.value_len;
+    if (pos + size + 1 > this->_size || (wrapped && pos + size >= this->_head))
+    {
+      ESP_LOGW(TAG, "Bad entry at %u, log truncated", pos);
+      break;
+    }
+
+    if (state == FRAM_KV_DEAD)
+    {
+      this->_dead += size;
+    }
+    else
+    {
+      this->_maxEntry = std::max(this->_maxEntry, size);
+      std::string key((const char *)at(pos, sizeof(entry) + entry.key_len) + sizeof(entry), entry.key_len);
+      int32_t slot = this->_find(key);
+      if (slot >= 0)
+      {
+        //  put() did not finish, the later entry wins
+        FRAM_KV_SLOT & s = this->_index[slot];
+        this->_kill(s.pos, sizeof(entry) + entry.key_len + s.value_len);
+        s.pos = pos;
+        s.value_len = entry.value_len;
+        //  _kill() wrote around the block
+        bufLen = 0;
+      }
+      else if (this->_count < this->_maxKeys)
+      {
+        this->_insert(this->_hash(key.data(), key.size()), pos, entry.value_len);
+      }
+      else
+      {
+        ESP_LOGW(TAG, "More than %u keys, \"%s\" dropped", this->_maxKeys, key.c_str());
+        this->_kill(pos, size);
+        bufLen = 0;
+      }
+    }
+
+    pos += size;
+  }
+
+  //  a truncated log ends here
+  this->_tail = pos;
+  this->_fram->write8(this->_addr(pos), FRAM_KV_END);
+  return true;
+}
+
+
+int32_t FRAM_KV::_find(const std::string & key)
+{
+  if (key.empty() || key.size() > 255) return -1;
+
+  uint32_t mask = this->_index.size() - 1;
+  uint16_t hash = this->_hash(key.data(), key.size());
+
+  for (uint32_t i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++)
+  {
+    FRAM_KV_SLOT & s = this->_index[i];
+    if (s.pos == FRAM_KV_EMPTY) return -1;
+    if (s.pos == FRAM_KV_TOMB || s.hash != hash) continue;
+    if (this->_keyAt(s.pos, key)) return i;
+  }
+  return -1;
+}
+
+
+void FRAM_KV::_insert(uint32_t hash, uint32_t pos, uint16_t value_len)
+{
+  if ((this->_count + this->_tombs + 1u) * 4 > this->_index.size() * 3) this->_rehash();
+
+  uint32_t mask = this->_index.size() - 1;
+  uint32_t i = hash & mask;
+  while (this->_index[i].pos != FRAM_KV_EMPTY && this->_index[i].pos != FRAM_KV_TOMB) i = (i + 1) & mask;
+
+  if (this->_index[i].pos == FRAM_KV_TOMB) this->_tombs--;
+  this->_index[i] = FRAM_KV_SLOT{pos, (uint16_t)hash, value_len};
+  this->_count++;
+}
+
+
+//  drop tombstones
+void FRAM_KV::_rehash()
+{
+  std::vector<FRAM_KV_SLOT> old(this->_index.size(), FRAM_KV_SLOT{FRAM_KV_EMPTY, 0, 0});
+  old.swap(this->_index);
+  this->_count = 0;
+  this->_tombs = 0;
+
+  for (auto & s : old)
+  {
+    if (s.pos != FRAM_KV_EMPTY && s.pos != FRAM_KV_TOMB) this->_insert(s.hash, s.pos, s.value_len);
+  }
+}
+
+
+bool FRAM_KV::_keyAt(uint32_t pos, const std::string & key)
+{
+  uint8_t buffer[sizeof(FRAM_KV_ENTRY) + 255];
+  this->_fram->read(this->_addr(pos), buffer, sizeof(FRAM_KV_ENTRY) + key.size());
+  return buffer[1] == key.size() && !memcmp(buffer + sizeof(FRAM_KV_ENTRY), key.data(), key.size());
+}
+
+
+bool FRAM_KV::_reserve(uint32_t size, uint32_t spare)
+{
+  //  the log ends with END
+  uint32_t need = size + 1;
+  //  at most one lap of compaction
+  uint32_t budget = this->_size;
+
+  while (true)
+  {
+    if (this->_head == this->_tail && this->_tail)
+    {
+      this->_head = 0;
+      this->_tail = 0;
+      this->_fram->write8(this->_addr(0), FRAM_KV_END);
+      this->_saveHead();
+    }
+
+    bool room = this->free() >= size + spare;
+
+    if (room && this->_tail < this->_head)
+    {
+      if (this->_tail + need <= this->_head) return true;
+    }
+    else if (room)
+    {
+      if (this->_tail + need <= this->_size) return true;
+      if (need <= this->_head)
+      {
+        //  END first, so the log is never open
+        this->_fram->write8(this->_addr(0), FRAM_KV_END);
+        this->_fram->write8(this->_addr(this->_tail), FRAM_KV_WRAP);
+        this->_dead += this->_size - this->_tail;
+        this->_tail = 0;
+        //  the skipped end is not free any more
+        continue;
+      }
+    }
+
+    uint32_t head = this->_head;
+    if (!this->_dead || !budget || !this->_compactStep()) return false;
+    uint32_t moved = (this->_head > head) ? this->_head - head : this->_size - head;
+    budget -= std::min(budget, moved);
+  }
+}
+
+
+void FRAM_KV::_append(const std::string & key, const uint8_t * value, uint16_t size)
+{
+  uint32_t pos = this->_tail;
+  uint32_t entry = sizeof(FRAM_KV_ENTRY) + key.size() + size;
+  uint8_t  buffer[FRAM_KV_READ_BUFFER];
+
+  //  everything but state, in one write when small
+  buffer[0] = key.size();
+  memcpy(buffer + 1, &size, 2);
+  if (entry - 1 <= FRAM_KV_READ_BUFFER)
+  {
+    memcpy(buffer + 3, key.data(), key.size());
+    memcpy(buffer + 3 + key.size(), value, size);
+    this->_fram->write(this->_addr(pos + 1), buffer, entry - 1);
+  }
+  else
+  {
+    this->_fram->write(this->_addr(pos + 1), buffer, 3);
+    this->_fram->write(this->_addr(pos + 4), (uint8_t *)key.data(), key.size());
+    this->_fram->write(this->_addr(pos + 4 + key.size()), (uint8_t *)value, size);
+  }
+
+  this->_fram->write8(this->_addr(pos + entry), FRAM_KV_END);
+  this->_commit(pos);
+  this->_tail = pos + entry;
+}
+
+
+//  the write buffer flushes in address order, not in write order:
+//  the entry and END must be on the chip before its state,
+//  and the state before anything that depends on it
+void FRAM_KV::_commit(uint32_t pos)
+{
+  this->_fram->flush();
+  this->_fram->write8(this->_addr(pos), FRAM_KV_LIVE);
+  this->_fram->flush();
+}
+
+
+bool FRAM_KV::_compactStep()
+{
+  if (this->_head == this->_tail) return false;
+
+  FRAM_KV_ENTRY entry;
+  this->_fram->readObject(this->_addr(this->_head), entry);
+
+  if (entry.state == FRAM_KV_WRAP)
+  {
+    this->_dead -= this->_size - this->_head;
+    this->_head = 0;
+    this->_saveHead();
+    return true;
+  }
+
+  uint32_t size = sizeof(entry) + entry.key_len + entry.value_len;
+
+  if (entry.state == FRAM_KV_DEAD)
+  {
+    this->_dead -= size;
+    this->_head += size;
+    this->_saveHead();
+    return true;
+  }
+
+  if (entry.state != FRAM_KV_LIVE) return false;
+
+  //  live entry to tail, without compacting again
+  uint32_t dead = this->_dead;
+  uint32_t head = this->_head;
+  this->_dead = 0;
+  bool room = this->_reserve(size, 0);
+  this->_dead += dead;
+  if (!room || this->_head != head) return false;
+
+  std::string key(entry.key_len, 0);
+  this->_fram->read(this->_addr(head + sizeof(entry)), (uint8_t *)&key[0], entry.key_len);
+  int32_t slot = this->_find(key);
+
+  //  copy all but state, then END and state
+  uint32_t pos = this->_tail;
+  uint8_t  buffer[FRAM_KV_READ_BUFFER];
+  for (uint32_t done = 1; done < size; )
+  {
+    uint32_t len = std::min(size - done, (uint32_t)FRAM_KV_READ_BUFFER);
+    this->_fram->read(this->_addr(head + done), buffer, len);
+    this->_fram->write(this->_addr(pos + done), buffer, len);
+    done += len;
+  }
+  this->_fram->write8(this->_addr(pos + size), FRAM_KV_END);
+  this->_commit(pos);
+  this->_tail = pos + size;
+
+  if (slot >= 0) this->_index[slot].pos = pos;
+  this->_head = head + size;
+  this->_saveHead();
+  return true;
+}
+
+
+void FRAM_KV::_kill(uint32_t pos, uint32_t size)
+{
+  this->_fram->write8(this->_addr(pos), FRAM_KV_DEAD);
+  this->_dead += size;
+}
+
+}  // namespace fram_kv
+}  // namespace esphome
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/fram/FRAM.h"
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace fram_kv {
+
+//  first byte of every entry in the log
+enum FRAM_KV_STATE : uint8_t {
+  FRAM_KV_END  = 0x00,  //  tail, no more entries
+  FRAM_KV_LIVE = 0xA5,
+  FRAM_KV_DEAD = 0x5A,  //  erased or overwritten
+  FRAM_KV_WRAP = 0xC3   //  next entry at the start of the log
+};
+
+//  followed by key and value
+struct FRAM_KV_ENTRY {
+  uint8_t state;
+  uint8_t key_len;
+  uint16_t value_len;
+};
+
+//  RAM index, open addressing with linear probing
+struct FRAM_KV_SLOT {
+  uint32_t pos;
+  uint16_t hash;
+  uint16_t value_len;
+};
+
+//  region start: magic, head, ~head
+static const uint32_t FRAM_KV_HEADER_SIZE = 12;
+//  get() of entries up to this size is one read
+static const uint16_t FRAM_KV_READ_BUFFER = 128;
+//  entries moved or skipped by loop() at a time
+static const uint8_t FRAM_KV_COMPACT_STEP = 4;
+
+//  key-value store, a circular log of entries in a FRAM region
+//  put() appends, the old entry is marked dead,
+//  loop() moves live entries from head to tail to free dead space.
+class FRAM_KV : public Component
+{
+public:
+  FRAM_KV(fram::FRAM * fram) : _fram(fram) {}
+
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+  void     setRegion(uint32_t memaddr, uint32_t size);
+  void     setMaxKeys(uint16_t keys) { this->_maxKeys = keys; };
+
+  //  keys up to 255 bytes
+  bool     put(const std::string & key, const uint8_t * value, uint16_t size);
+  //  returns value size, -1 if not found or value does not fit in buflen
+  int32_t  get(const std::string & key, uint8_t * value, uint16_t buflen);
+  bool     erase(const std::string & key);
+  bool     has(const std::string & key) { return this->_find(key) >= 0; };
+
+  template <class T> bool putObject(const std::string & key, T &obj)
+  {
+    return this->put(key, (const uint8_t *) &obj, sizeof(obj));
+  };
+  template <class T> bool getObject(const std::string & key, T &obj)
+  {
+    return this->get(key, (uint8_t *) &obj, sizeof(obj)) == sizeof(obj);
+  };
+
+  uint16_t count() { return this->_count; };
+  //  bytes for new entries, dead bytes are free after compaction
+  uint32_t free();
+  uint32_t getDeadBytes() { return this->_dead; };
+  //  drop all keys
+  void     wipe();
+
+protected:
+  fram::FRAM * _fram;
+  uint32_t _start{0};
+  uint32_t _size{0};
+  uint16_t _maxKeys{256};
+
+  uint32_t _head{0};
+  uint32_t _tail{0};
+  uint32_t _dead{0};
+  uint16_t _count{0};
+  //  largest entry, room for moving it is kept free
+  uint32_t _maxEntry{0};
+
+  std::vector<FRAM_KV_SLOT> _index;
+  uint16_t _tombs{0};
+
+  uint32_t _addr(uint32_t pos) { return this->_start + FRAM_KV_HEADER_SIZE + pos; };
+  uint32_t _hash(const char * key, uint8_t len);
+  uint32_t _magic();
+  void     _saveHead();
+  bool     _scan();
+
+  //  index slot of key, -1 if not found
+  int32_t  _find(const std::string & key);
+  void     _insert(uint32_t hash, uint32_t pos, uint16_t value_len);
+  void     _rehash();
+  bool     _keyAt(uint32_t pos, const std::string & key);
+
+  //  room for size bytes at tail, with END after them and spare bytes
+  //  free elsewhere, returns false if none
+  bool     _reserve(uint32_t size, uint32_t spare);
+  //  entry at tail, state written last
+  void     _append(const std::string & key, const uint8_t * value, uint16_t size);
+  //  state LIVE at pos, ordered with the write buffer
+  void     _commit(uint32_t pos);
+  //  entry at head: skip dead, move live to tail
+  bool     _compactStep();
+  void     _kill(uint32_t pos, uint32_t size);
+};
+
+}  // namespace fram_kv
+}  // namespace esphome
@@ -0,0 +1,31 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import fram
+from esphome.const import CONF_ID, CONF_SIZE
+
+DEPENDENCIES = ["fram"]
+MULTI_CONF = True
+CONF_FRAM_ID = "fram_id"
+CONF_START = "start"
+CONF_MAX_KEYS = "max_keys"
+
+fram_kv_ns = cg.esphome_ns.namespace("fram_kv")
+FRAMKVComponent = fram_kv_ns.class_("FRAM_KV", cg.Component)
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.declare_id(FRAMKVComponent),
+    cv.GenerateID(CONF_FRAM_ID): cv.use_id(fram.FRAMComponent),
+    cv.Optional(CONF_START, default=0): cv.int_range(min=0),
+    # 12 bytes of region header, the rest is the log
+    cv.Required(CONF_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=256)),
+    cv.Optional(CONF_MAX_KEYS, default=256): cv.int_range(min=1,max=16384)
+}).extend(cv.COMPONENT_SCHEMA)
+
+async def to_code(config):
+    fram = await cg.get_variable(config[CONF_FRAM_ID])
+    
+    var = cg.new_Pvariable(config[CONF_ID], fram)
+    await cg.register_component(var, config)
+    
+    cg.add(var.setRegion(config[CONF_START], config[CONF_SIZE]))
+    cg.add(var.setMaxKeys(config[CONF_MAX_KEYS]))
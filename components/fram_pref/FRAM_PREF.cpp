@@ -2,100 +2,260 @@
 #include "esphome/core/log.h"
 #include "esphome/core/application.h"
 #include "FRAM_PREF.h"
+#include <algorithm>
+#include <cstddef>
 
 namespace esphome {
 namespace fram_pref {
 
 static const char * const TAG = "fram_pref";
 
-class FRAMPreferenceBackend : public ESPPreferenceBackend {
-  public:
-    FRAMPreferenceBackend(FRAM_PREF * comp, uint32_t type, uint8_t idx) {
-      this->comp_ = comp;
-      this->type_ = type;
-      this->idx_ = idx;
-    }
+FRAM_PREF * FRAMPreferenceBackend::comp_ = nullptr;
+
+bool FRAMPreferenceBackend::save(const uint8_t *data, size_t len) {
+  if( (this->size_req-2) != (uint16_t)len ) {
+    return false;
+  }
+  //  no record yet, or none will be
+  if (this->flags & (FLAG_PENDING|FLAG_ERR)) {
+    return false;
+  }
+  
+  uint8_t trailer[FRAM_PREF_TRAILER_MAX];
+  uint8_t tlen = this->trailer_(data, len, trailer);
+  
+  this->saves++;
+  uint8_t * shadow = this->comp_->_shadow(this->addr, len+tlen);
+  uint64_t digest = this->digest_(data, len);
+  
+  //  same as on FRAM, no bus traffic
+  if (!shadow && (this->flags & FLAG_DIGEST) && this->digest == digest) {
+    this->saves_skipped++;
+    return true;
+  }
+  
+  fram::FRAM_SEGMENT segs[FRAM_PREF_SAVE_RUNS*2];
+  uint8_t cnt = 0;
+  
+  if (shadow) {
+    cnt = this->diff_(this->addr, data, len, trailer, tlen, shadow, segs);
     
-    bool save(const uint8_t *data, size_t len) override {
-      if (!this->comp_->fram_->isConnected()) {
-        return false;
-      }
-      
-      auto & pref = this->comp_->prefs_[this->idx_];
-      
-      if( (pref.size_req-2) != (uint16_t)len ) {
-        return false;
-      }
-      
-      uint16_t checksum = this->checksum_((uint8_t*)data, len);
-      
-      this->comp_->fram_->write(pref.addr, (uint8_t*)data, len);
-      this->comp_->fram_->write(pref.addr+len, (uint8_t*)&checksum, 2);
-      
+    if (!cnt) {
+      this->saves_skipped++;
+      this->digest = digest;
+      this->flags |= FLAG_DIGEST;
       return true;
     }
+  }
+  else {
+    segs[cnt++] = {this->addr, (uint8_t*)data, (uint16_t)len};
+    segs[cnt++] = {(uint32_t)(this->addr+len), trailer, tlen};
+  }
+  
+  if (!this->comp_->fram_->isConnected()) {
+    return false;
+  }
+  
+  uint32_t written = 0;
+  for (uint8_t i = 0; i < cnt; i++) {
+    written += segs[i].size;
+  }
+  if (written < len+tlen) {
+    this->saves_partial++;
+  }
+  
+  //  data and trailer are adjacent, one transaction if they fit
+  this->comp_->fram_->writev(segs, cnt);
+  
+  if (shadow) {
+    memcpy(shadow, data, len);
+    memcpy(shadow+len, trailer, tlen);
+  }
+  
+  this->digest = digest;
+  this->flags |= FLAG_DIGEST;
+  
+  return true;
+}
+
+bool FRAMPreferenceBackend::load(uint8_t *data, size_t len) {
+  if( (this->size_req-2) != (uint16_t)len ) {
+    return false;
+  }
+  if (this->flags & (FLAG_PENDING|FLAG_ERR)) {
+    return false;
+  }
+  
+  uint32_t start = micros();
+  bool ok = this->load_(data, len);
+  
+  if (ok) {
+    this->digest = this->digest_(data, len);
+    this->flags |= FLAG_DIGEST;
+  }
+  this->comp_->loads_us_ += micros() - start;
+  
+  return ok;
+}
+
+//  checksum, then the pool epoch for pool records,
+//  records of an older epoch do not match and are not loaded
+uint8_t FRAMPreferenceBackend::trailer_(const uint8_t *data, size_t len, uint8_t *trailer) {
+  uint16_t checksum = this->checksum_((uint8_t*)data, len);
+  memcpy(trailer, &checksum, 2);
+  
+  if (this->flags & FLAG_STATIC) {
+    return 2;
+  }
+  
+  memcpy(trailer+2, &this->comp_->pool_epoch_, 2);
+  return 4;
+}
+
+//  changed byte ranges of data and trailer against the shadow,
+//  runs closer than the gap threshold are written as one
+uint8_t FRAMPreferenceBackend::diff_(uint16_t addr, const uint8_t *data, size_t len, uint8_t *trailer, uint8_t tlen, const uint8_t *shadow, fram::FRAM_SEGMENT *segs) {
+  uint16_t runs[FRAM_PREF_SAVE_RUNS][2];
+  uint8_t run_cnt = 0;
+  uint8_t gap = this->comp_->fram_->getGapThreshold();
+  
+  for (size_t i = 0; i < len+tlen; i++) {
+    uint8_t b = (i < len) ? data[i] : trailer[i-len];
     
-    bool load(uint8_t *data, size_t len) override {
-      if (!this->comp_->fram_->isConnected()) {
-        return false;
-      }
-      
-      auto & pref = this->comp_->prefs_[this->idx_];
-      
-      if( (pref.size_req-2) != (uint16_t)len ) {
-        return false;
-      }
-      
-      std::vector<uint8_t> buff;
-      buff.resize(len);
-      this->comp_->fram_->read(pref.addr, buff.data(), len);
-      
-      if (this->checksum_(buff.data(), len) != this->comp_->fram_->read16(pref.addr+len)) {
-        return false;
-      }
-      
-      memcpy(data, buff.data(), len);
-      return true;
+    if (b == shadow[i]) {
+      continue;
+    }
+    
+    if (run_cnt && (i - runs[run_cnt-1][1] <= gap || run_cnt == FRAM_PREF_SAVE_RUNS)) {
+      runs[run_cnt-1][1] = i+1;
+    }
+    else {
+      runs[run_cnt][0] = i;
+      runs[run_cnt][1] = i+1;
+      run_cnt++;
     }
+  }
   
-  protected:
-    uint16_t checksum_(uint8_t *data, size_t len) {
-      uint16_t sum = (this->type_ >> 16) + (this->type_ & 0xFFFF);
-      
-      for (size_t i = 0; i < len; i++) {
-        sum += data[i];
-      }
-      
-      return sum;
+  //  runs reaching into the trailer are split, writev() joins them again
+  uint8_t cnt = 0;
+  for (uint8_t r = 0; r < run_cnt; r++) {
+    uint16_t start = runs[r][0];
+    uint16_t end = runs[r][1];
+    
+    if (start < len) {
+      uint16_t data_end = std::min<uint16_t>(end, len);
+      segs[cnt++] = {(uint32_t)(addr+start), (uint8_t*)data+start, (uint16_t)(data_end-start)};
+      start = data_end;
     }
+    if (end > start) {
+      segs[cnt++] = {(uint32_t)(addr+start), trailer+(start-len), (uint16_t)(end-start)};
+    }
+  }
+  
+  return cnt;
+}
+
+//  64 bit FNV-1a, to skip saves of unchanged data without a shadow,
+//  wide enough that a change matching the old digest is not expected
+uint64_t FRAMPreferenceBackend::digest_(const uint8_t *data, size_t len) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ data[i]) * 0x00000100000001B3ULL;
+  }
+  
+  return hash;
+}
+
+bool FRAMPreferenceBackend::load_(uint8_t *data, size_t len) {
+  uint8_t trailer[FRAM_PREF_TRAILER_MAX];
+  uint8_t tlen = (this->flags & FLAG_STATIC) ? 2 : 4;
+  
+  //  new epoch and not saved since, the record can only be stale
+  if (tlen == 4 && this->comp_->pool_cleared_ && !(this->flags & FLAG_DIGEST)) {
+    return false;
+  }
+  uint8_t * shadow = this->comp_->_shadow(this->addr, len+tlen);
+  
+  if (shadow) {
+    this->comp_->loads_shadow_++;
+    this->trailer_(shadow, len, trailer);
     
-    FRAM_PREF * comp_;
-    uint32_t type_;
-    uint8_t idx_;
-};
+    if (memcmp(shadow+len, trailer, tlen)) {
+      return false;
+    }
+    
+    memcpy(data, shadow, len);
+    return true;
+  }
+  
+  if (!this->comp_->fram_->isConnected()) {
+    return false;
+  }
+  
+  this->comp_->loads_fram_++;
+  
+  //  data and trailer in one read
+  std::vector<uint8_t> buff;
+  buff.resize(len+tlen);
+  this->comp_->fram_->read(this->addr, buff.data(), len+tlen);
+  this->trailer_(buff.data(), len, trailer);
+  
+  if (memcmp(buff.data()+len, trailer, tlen)) {
+    return false;
+  }
+  
+  memcpy(data, buff.data(), len);
+  return true;
+}
+
+uint16_t FRAMPreferenceBackend::checksum_(uint8_t *data, size_t len) {
+  uint16_t sum = (this->type >> 16) + (this->type & 0xFFFF);
+  
+  for (size_t i = 0; i < len; i++) {
+    sum += data[i];
+  }
+  
+  return sum;
+}
 
 FRAM_PREF::FRAM_PREF(fram::FRAM * fram) {
   this->fram_ = fram;
+  FRAMPreferenceBackend::comp_ = this;
 }
 
 void FRAM_PREF::set_pool(uint16_t pool_size, uint16_t pool_start=0) {
   this->pool_size_ = pool_size;
   this->pool_start_ = pool_start;
-  this->pool_next_ = pool_start + 4;
 }
 
-void FRAM_PREF::set_static_pref(std::string key, uint16_t addr, uint16_t size, std::function<uint32_t()> && fn, bool persist_key) {
+void FRAM_PREF::set_static_pref(const char * key, uint16_t addr, uint16_t size, std::function<uint32_t()> && fn, bool persist_key) {
   uint8_t flags = FLAG_STATIC;
   
   if (persist_key) {
     flags |= FLAG_PERSIST_KEY;
   }
   
-  this->prefs_.push_back({.key=key, .addr=addr, .size=size, .size_req=0, .flags=flags});
-  this->prefs_static_cb_.push_back(fn);
+  this->prefs_.emplace_back(PREF_STRUCT{.key=key, .addr=addr, .size=size, .size_req=0, .flags=flags});
+  this->prefs_static_cb_.push_back({this->prefs_.size() - 1, fn});
+}
+
+void FRAM_PREF::set_static_table(const FRAM_PREF_STATIC * table, uint16_t count) {
+  this->static_table_ = table;
+  this->static_table_cnt_ = count;
+  
+  //  before any set_static_pref(), table index is prefs_ index
+  for (uint16_t i = 0; i < count; i++) {
+    this->prefs_.emplace_back(PREF_STRUCT{.key=table[i].key, .addr=table[i].addr, .size=table[i].size, .size_req=0, .flags=table[i].flags});
+  }
 }
 
 void FRAM_PREF::setup() {
+  uint32_t start = micros();
+#ifdef USE_FRAM_STATS
+  fram::FRAM_STATS stats = this->fram_->getStats();
+#endif
+  
   if (!this->_check()) {
     this->mark_failed();
     return;
@@ -111,24 +271,81 @@ void FRAM_PREF::setup() {
     if (fram_size && (addr_end >= fram_size)) {
       pref.flags |= FLAG_ERR|FLAG_ERR_SIZE_FRAM;
     }
-    
-    this->prefs_static_map_.insert({(this->prefs_static_cb_[i])(), i});
   }
   
-  this->prefs_static_cb_.clear();
+  for (auto & cb : this->prefs_static_cb_) {
+    this->prefs_static_.push_back({(cb.second)(), cb.first});
+  }
+  
+  std::sort(this->prefs_static_.begin(), this->prefs_static_.end());
+  std::vector<std::pair<uint16_t,std::function<uint32_t()>>>().swap(this->prefs_static_cb_);
   
   if (this->pool_size_) {
-    uint32_t hash = fnv1_hash(App.get_compilation_time());
+    FRAM_PREF_POOL header;
+    this->fram_->readObject(this->pool_start_, header);
+    
+    uint32_t dir_max = (this->pool_size_ - FRAM_PREF_POOL_HEADER) / sizeof(FRAM_PREF_DIR);
+    bool valid = (header.magic == this->_pool_magic()) && (header.count <= dir_max);
+    
+    if (valid && header.count) {
+      this->pool_dir_.resize(header.count);
+      this->fram_->read(this->pool_start_ + FRAM_PREF_POOL_HEADER, (uint8_t*)this->pool_dir_.data(), header.count * sizeof(FRAM_PREF_DIR));
+      
+      uint32_t dir_end = this->pool_start_ + FRAM_PREF_POOL_HEADER + header.count * sizeof(FRAM_PREF_DIR);
+      for (auto & dir : this->pool_dir_) {
+        if (dir.addr < dir_end || (dir.addr + dir.length + 4 > this->pool_start_ + this->pool_size_)) {
+          valid = false;
+        }
+      }
+    }
     
-    if (hash != this->fram_->read32(this->pool_start_)) {
-      this->_clear();
-      this->fram_->write32(this->pool_start_, hash);
+    //  first use, pool moved or resized, or reset(): a new epoch
+    //  invalidates all records, nothing is cleared
+    if (!valid) {
+      header.magic = this->_pool_magic();
+      header.epoch++;
+      header.count = 0;
+      this->fram_->writeObject(this->pool_start_, header);
+      this->pool_dir_.clear();
       this->pool_cleared_ = true;
     }
+    
+    this->pool_epoch_ = header.epoch;
+    std::sort(this->pool_dir_.begin(), this->pool_dir_.end(),
+      [](const FRAM_PREF_DIR & a, const FRAM_PREF_DIR & b) { return a.addr > b.addr; });
+    this->pool_claimed_.assign(this->pool_dir_.size(), false);
+  }
+  
+  if (this->shadow_enabled_) {
+    this->_shadow_load();
   }
   
   this->pref_prev_ = global_preferences;
   global_preferences = this;
+  
+  this->setup_us_ = micros() - start;
+#ifdef USE_FRAM_STATS
+  auto & st = this->fram_->getStats();
+  this->setup_transactions_ = (st.reads + st.writes) - (stats.reads + stats.writes);
+  this->setup_bytes_ = (st.bytes_read + st.bytes_written) - (stats.bytes_read + stats.bytes_written);
+#endif
+}
+
+void FRAM_PREF::loop() {
+  //  all components are set up and requested their preferences,
+  //  records not requested since boot can be reclaimed now
+  this->booted_ = true;
+  
+  if (this->pool_pending_) {
+    this->_pool_pending();
+  }
+  
+  if (!this->shadow_keep_ && !this->shadow_.empty()) {
+    this->_shadow_release();
+  }
+  
+  //  nothing left to do after boot
+  this->disable_loop();
 }
 
 void FRAM_PREF::dump_config() {
@@ -136,7 +353,9 @@ void FRAM_PREF::dump_config() {
   
   ESP_LOGCONFIG(TAG, "FRAM_PREF:");
   
-  if (!this->_check()) {
+  //  setup() already probed the chip
+  if (this->is_failed()) {
+    ESP_LOGE(TAG, "  Setup failed!");
     return;
   }
   
@@ -149,14 +368,47 @@ void FRAM_PREF::dump_config() {
     }
     
     if (this->pool_cleared_) {
-      ESP_LOGI(TAG, "  Pool was cleared");
+      ESP_LOGI(TAG, "  Pool was cleared, epoch %u", this->pool_epoch_);
+    }
+    
+    uint32_t used = FRAM_PREF_POOL_HEADER;
+    uint16_t unused = 0;
+    for (size_t i = 0; i < this->pool_dir_.size(); i++) {
+      used += sizeof(FRAM_PREF_DIR) + this->pool_dir_[i].length + 4;
+      unused += !this->pool_claimed_[i];
     }
     
-    ESP_LOGCONFIG(TAG, "  Pool: %u bytes used", this->pool_next_ - this->pool_start_);
+    ESP_LOGCONFIG(TAG, "  Pool: %u entries, %u not requested since boot, %u bytes used", (unsigned)this->pool_dir_.size(), unused, used);
+    if (this->pool_reclaimed_) {
+      ESP_LOGCONFIG(TAG, "  Pool: %u entries reclaimed", this->pool_reclaimed_);
+    }
+  }
+  
+  ESP_LOGCONFIG(TAG, "  Setup: %uus", this->setup_us_);
+#ifdef USE_FRAM_STATS
+  ESP_LOGCONFIG(TAG, "  Setup: %u transactions, %u bytes", this->setup_transactions_, this->setup_bytes_);
+#endif
+  ESP_LOGCONFIG(TAG, "  Loads: %u from shadow, %u from FRAM, %uus", this->loads_shadow_, this->loads_fram_, this->loads_us_);
+  
+  if (this->shadow_released_) {
+    ESP_LOGCONFIG(TAG, "  Shadow: released");
   }
+  else if (!this->shadow_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Shadow: %u bytes", (unsigned)this->shadow_.size());
+  }
+  
+  //  heap held after setup, shadow included until released
+  uint32_t ram = this->prefs_.size() * sizeof(FRAMPreferenceBackend)
+    + this->pool_dir_.capacity() * sizeof(FRAM_PREF_DIR)
+    + (this->pool_claimed_.capacity() + 7) / 8
+    + this->prefs_static_.capacity() * sizeof(std::pair<uint32_t,uint16_t>)
+    + this->shadow_.capacity()
+    + this->shadow_static_.capacity() * sizeof(fram::FRAM_SEGMENT);
+  
+  ESP_LOGCONFIG(TAG, "  RAM: %u bytes, %u prefs of %u bytes", ram, (unsigned)this->prefs_.size(), (unsigned)sizeof(FRAMPreferenceBackend));
   
   for (auto & pref : this->prefs_) {
-    std::string msg = str_sprintf("  Pref: key: %s", pref.key.c_str());
+    std::string msg = pref.key ? str_sprintf("  Pref: key: %s", pref.key) : str_sprintf("  Pref: key: %u", pref.type);
     
     if (pref.flags & FLAG_STATIC) {
       //msg += ", STATIC";
@@ -172,6 +424,9 @@ void FRAM_PREF::dump_config() {
     if (pref.size_req) {
       msg += str_sprintf(", request size: %u", pref.size_req);
     }
+    if (pref.saves) {
+      msg += str_sprintf(", saves: %u (%u skipped, %u partial)", pref.saves, pref.saves_skipped, pref.saves_partial);
+    }
     
     if (!pref.size) {
       //msg += ", IGNORE";
@@ -210,21 +465,79 @@ bool FRAM_PREF::_check() {
   return true;
 }
 
-void FRAM_PREF::_clear() {
-  if (!this->pool_size_) {
+void FRAM_PREF::_shadow_load() {
+  //  from the lowest record to the pool end, none after a new epoch
+  this->shadow_pool_addr_ = this->pool_start_ + this->pool_size_;
+  for (auto & dir : this->pool_dir_) {
+    this->shadow_pool_addr_ = std::min(this->shadow_pool_addr_, dir.addr);
+  }
+  this->shadow_pool_ = this->pool_start_ + this->pool_size_ - this->shadow_pool_addr_;
+  
+  uint32_t total = this->shadow_pool_;
+  uint32_t fram_size = this->fram_->getSizeBytes();
+  
+  for (auto & pref : this->prefs_) {
+    if ((pref.flags & FLAG_STATIC) && pref.size && !(pref.flags & FLAG_ERR)) {
+      total += pref.size;
+    }
+  }
+  
+  if (!total || (this->pool_size_ && (this->pool_start_ + this->pool_size_ > fram_size))) {
     return;
   }
   
-  uint8_t buff[16];
-  uint16_t pool_end = this->pool_start_ + this->pool_size_;
+  this->shadow_.resize(total);
+  uint8_t * next = this->shadow_.data() + this->shadow_pool_;
+  
+  for (auto & pref : this->prefs_) {
+    if ((pref.flags & FLAG_STATIC) && pref.size && !(pref.flags & FLAG_ERR)) {
+      this->shadow_static_.push_back({pref.addr, next, pref.size});
+      next += pref.size;
+    }
+  }
   
-  for (uint8_t i = 0; i < 16; i++) buff[i] = 0;
+  std::sort(this->shadow_static_.begin(), this->shadow_static_.end(),
+    [](const fram::FRAM_SEGMENT & a, const fram::FRAM_SEGMENT & b) { return a.memaddr < b.memaddr; });
   
-  for (uint16_t addr = this->pool_start_+4; addr < pool_end; addr += 16) {
-    this->fram_->write(addr, buff, std::min(16,pool_end-addr));
+  //  the pool in max_transfer blocks, static regions merged where close
+  if (this->shadow_pool_) {
+    this->fram_->read(this->shadow_pool_addr_, this->shadow_.data(), this->shadow_pool_);
   }
   
-  ESP_LOGD(TAG, "Pool cleared!");
+  for (size_t i = 0; i < this->shadow_static_.size(); i += 255) {
+    size_t cnt = std::min<size_t>(255, this->shadow_static_.size() - i);
+    this->fram_->readv(&this->shadow_static_[i], cnt);
+  }
+}
+
+void FRAM_PREF::_shadow_release() {
+  std::vector<uint8_t>().swap(this->shadow_);
+  std::vector<fram::FRAM_SEGMENT>().swap(this->shadow_static_);
+  this->shadow_released_ = true;
+}
+
+uint8_t * FRAM_PREF::_shadow(uint16_t addr, uint16_t len) {
+  if (this->shadow_.empty()) {
+    return nullptr;
+  }
+  
+  if ((addr >= this->shadow_pool_addr_) && (addr + len <= this->shadow_pool_addr_ + this->shadow_pool_)) {
+    return this->shadow_.data() + (addr - this->shadow_pool_addr_);
+  }
+  
+  auto it = std::upper_bound(this->shadow_static_.begin(), this->shadow_static_.end(), addr,
+    [](uint16_t addr, const fram::FRAM_SEGMENT & seg) { return addr < seg.memaddr; });
+  
+  if (it == this->shadow_static_.begin()) {
+    return nullptr;
+  }
+  
+  --it;
+  if (addr + len > it->memaddr + it->size) {
+    return nullptr;
+  }
+  
+  return it->obj + (addr - it->memaddr);
 }
 
 ESPPreferenceObject FRAM_PREF::make_preference(size_t length, uint32_t type, bool in_flash) {
@@ -236,13 +549,13 @@ ESPPreferenceObject FRAM_PREF::make_preference(size_t length, uint32_t type) {
     return {};
   }
   
-  auto pref_static_it = this->prefs_static_map_.find(type);
+  int32_t pref_static = this->_static_find(type);
   uint16_t size = (uint16_t)length + 2;
   uint16_t addr;
-  uint8_t idx;
+  uint16_t idx;
   
-  if(pref_static_it != this->prefs_static_map_.end()) {
-    idx = pref_static_it->second;
+  if(pref_static >= 0) {
+    idx = pref_static;
     auto & pref = this->prefs_[idx];
     
     pref.size_req = size;
@@ -258,38 +571,197 @@ ESPPreferenceObject FRAM_PREF::make_preference(size_t length, uint32_t type) {
     addr = pref.addr;
     
     if (pref.flags & FLAG_PERSIST_KEY) {
-      type = fnv1_hash(pref.key);
+      type = fnv1_hash(std::string(pref.key));
     }
   }
   else {
-    this->prefs_.push_back({.key=std::to_string(type), .addr=0, .size=0, .size_req=size, .flags=0});
+    this->prefs_.emplace_back(PREF_STRUCT{.key=nullptr, .type=type, .addr=0, .size=0, .size_req=size, .flags=0});
     idx = this->prefs_.size() - 1;
     
     if(!this->pool_size_) {
       return {};
     }
     
-    uint16_t pool_end = this->pool_start_ + this->pool_size_;
-    uint16_t next = this->pool_next_ + size;
-    addr = this->pool_next_;
+    int32_t dir = this->_pool_find(type, length);
+    if (dir < 0) {
+      dir = this->_pool_add(type, length);
+    }
     
-    this->prefs_[idx].addr = addr;
-    this->prefs_[idx].size = size;
+    //  pool records also carry the epoch
+    this->prefs_[idx].size = size + 2;
     
-    if (next > pool_end) {
+    //  the pool is full of records not requested yet, components
+    //  set up later may still ask for them, decided in loop()
+    if (dir < 0 && !this->booted_) {
+      this->prefs_[idx].flags |= FLAG_PENDING;
+      this->pool_pending_++;
+      return {&this->prefs_[idx]};
+    }
+    if (dir < 0) {
       this->prefs_[idx].flags |= FLAG_ERR|FLAG_ERR_SIZE_POOL;
       return {};
     }
     
-    this->pool_next_ = next;
+    this->pool_claimed_[dir] = true;
+    addr = this->pool_dir_[dir].addr;
+    this->prefs_[idx].addr = addr;
+  }
+  
+  this->prefs_[idx].type = type;
+  
+  return {&this->prefs_[idx]};
+}
+
+int32_t FRAM_PREF::_static_find(uint32_t type) {
+  auto table_end = this->static_table_ + this->static_table_cnt_;
+  auto table_it = std::lower_bound(this->static_table_, table_end, type,
+    [](const FRAM_PREF_STATIC & entry, uint32_t type) { return entry.type < type; });
+  
+  if (table_it != table_end && table_it->type == type) {
+    return table_it - this->static_table_;
+  }
+  
+  auto it = std::lower_bound(this->prefs_static_.begin(), this->prefs_static_.end(), std::make_pair(type, (uint16_t)0));
+  
+  if (it != this->prefs_static_.end() && it->first == type) {
+    return it->second;
+  }
+  
+  return -1;
+}
+
+uint32_t FRAM_PREF::_pool_magic() {
+  //  directory addresses are only valid for the same pool
+  return fnv1_hash("fram_pref") ^ (((uint32_t)this->pool_size_ << 16) | this->pool_start_);
+}
+
+int32_t FRAM_PREF::_pool_find(uint32_t type, uint16_t length) {
+  //  the first not yet requested, for prefs with the same type
+  for (size_t i = 0; i < this->pool_dir_.size(); i++) {
+    auto & dir = this->pool_dir_[i];
+    
+    if (dir.type == type && dir.length == length && !this->pool_claimed_[i]) {
+      return i;
+    }
+  }
+  
+  return -1;
+}
+
+int32_t FRAM_PREF::_pool_add(uint32_t type, uint16_t length) {
+  uint16_t addr = this->_pool_alloc(length + 4);
+  
+  if (!addr && this->booted_ && this->_pool_reclaim()) {
+    addr = this->_pool_alloc(length + 4);
+  }
+  if (!addr) {
+    return -1;
+  }
+  
+  auto it = std::upper_bound(this->pool_dir_.begin(), this->pool_dir_.end(), addr,
+    [](uint16_t addr, const FRAM_PREF_DIR & dir) { return addr > dir.addr; });
+  size_t i = it - this->pool_dir_.begin();
+  
+  this->pool_dir_.insert(it, {.type=type, .length=length, .addr=addr});
+  this->pool_claimed_.insert(this->pool_claimed_.begin() + i, false);
+  
+  //  the space may hold an old record, its epoch can not match
+  uint16_t epoch = ~this->pool_epoch_;
+  this->fram_->write16(addr + length + 2, epoch);
+  
+  uint8_t * shadow = this->_shadow(addr + length + 2, 2);
+  if (shadow) {
+    memcpy(shadow, &epoch, 2);
+  }
+  
+  //  entry first, it is used once the count includes it.
+  //  the write buffer flushes in address order, the count is lower
+  this->fram_->writeObject(this->pool_start_ + FRAM_PREF_POOL_HEADER + (this->pool_dir_.size() - 1) * sizeof(FRAM_PREF_DIR), this->pool_dir_[i]);
+  this->fram_->flush();
+  this->fram_->write16(this->pool_start_ + offsetof(FRAM_PREF_POOL, count), this->pool_dir_.size());
+  
+  return i;
+}
+
+uint16_t FRAM_PREF::_pool_alloc(uint16_t size) {
+  //  room for one more directory entry below the lowest record
+  uint32_t dir_end = this->pool_start_ + FRAM_PREF_POOL_HEADER + (this->pool_dir_.size() + 1) * sizeof(FRAM_PREF_DIR);
+  uint32_t top = this->pool_start_ + this->pool_size_;
+  
+  if (!this->pool_dir_.empty() && this->pool_dir_.back().addr < dir_end) {
+    return 0;
   }
   
-  auto * pref = new FRAMPreferenceBackend(this, type, idx);
+  //  first gap from the pool end down that fits
+  for (auto & dir : this->pool_dir_) {
+    if (top >= (uint32_t)dir.addr + dir.length + 4 + size) {
+      return top - size;
+    }
+    top = dir.addr;
+  }
+  
+  if (top >= dir_end + size) {
+    return top - size;
+  }
+  
+  return 0;
+}
+
+bool FRAM_PREF::_pool_reclaim() {
+  size_t count = 0;
+  
+  for (size_t i = 0; i < this->pool_dir_.size(); i++) {
+    if (this->pool_claimed_[i]) {
+      this->pool_dir_[count++] = this->pool_dir_[i];
+    }
+  }
+  
+  if (count == this->pool_dir_.size()) {
+    return false;
+  }
+  
+  ESP_LOGD(TAG, "Pool: reclaimed %u entries", (unsigned)(this->pool_dir_.size() - count));
+  
+  this->pool_reclaimed_ += this->pool_dir_.size() - count;
+  this->pool_dir_.resize(count);
+  this->pool_claimed_.assign(count, true);
+  
+  //  entries first, cut short an old count only leaves duplicates
+  if (count) {
+    this->fram_->write(this->pool_start_ + FRAM_PREF_POOL_HEADER, (uint8_t*)this->pool_dir_.data(), count * sizeof(FRAM_PREF_DIR));
+  }
+  this->fram_->flush();
+  this->fram_->write16(this->pool_start_ + offsetof(FRAM_PREF_POOL, count), count);
+  
+  return true;
+}
+
+void FRAM_PREF::_pool_pending() {
+  this->_pool_reclaim();
+  
+  for (auto & pref : this->prefs_) {
+    if (!(pref.flags & FLAG_PENDING)) {
+      continue;
+    }
+    
+    pref.flags &= ~FLAG_PENDING;
+    int32_t dir = this->_pool_add(pref.type, pref.size_req - 2);
+    
+    if (dir < 0) {
+      pref.flags |= FLAG_ERR|FLAG_ERR_SIZE_POOL;
+      continue;
+    }
+    
+    this->pool_claimed_[dir] = true;
+    pref.addr = this->pool_dir_[dir].addr;
+  }
   
-  return {pref};
+  this->pool_pending_ = 0;
 }
 
 bool FRAM_PREF::sync() {
+  //  saves still in the fram write buffer
+  this->fram_->flush();
   return this->pref_prev_->sync();
 }
 
@@ -3,7 +3,9 @@
 #include "esphome/core/component.h"
 #include "esphome/core/preferences.h"
 #include "esphome/components/fram/FRAM.h"
-#include <map>
+#include <deque>
+#include <functional>
+#include <vector>
 
 namespace esphome {
 namespace fram_pref {
@@ -11,28 +13,98 @@ namespace fram_pref {
 enum Flags : uint8_t {
   FLAG_STATIC        = 0b00000001,
   FLAG_PERSIST_KEY   = 0b00000010,
+  FLAG_DIGEST        = 0b00000100,
+  FLAG_PENDING       = 0b00001000,
   FLAG_ERR           = 0b10000000,
   FLAG_ERR_SIZE_REQ  = 0b00010000,
   FLAG_ERR_SIZE_FRAM = 0b00100000,
   FLAG_ERR_SIZE_POOL = 0b01000000
 };
 
+//  packed for many prefs on small heaps, the key of static prefs
+//  points to a string literal in .rodata (flash on ESP32 and RP2040,
+//  RAM on ESP8266), pool prefs show their type
 struct PREF_STRUCT {
-  std::string key;
+  //  of the data on FRAM, valid with FLAG_DIGEST
+  uint64_t digest{0};
+  const char * key;
+  //  make_preference() hash, checksum seed
+  uint32_t type{0};
   uint16_t addr;
   uint16_t size;
   uint16_t size_req;
+  uint16_t saves{0};
+  uint16_t saves_skipped{0};
+  uint16_t saves_partial{0};
   uint8_t flags;
 };
 
+//  static prefs with the hash known at compile time,
+//  a table sorted by type generated by codegen, in .rodata as the keys
+struct FRAM_PREF_STATIC {
+  uint32_t type;
+  uint16_t addr;
+  uint16_t size;
+  uint8_t flags;
+  const char * key;
+};
+
+//  at pool start, followed by the directory, records are allocated
+//  from the pool end down. a new epoch invalidates all records.
+struct FRAM_PREF_POOL {
+  uint32_t magic;
+  uint16_t epoch;
+  uint16_t count;
+};
+static const uint8_t FRAM_PREF_POOL_HEADER = sizeof(FRAM_PREF_POOL);
+
+//  directory entry, the pool record of a type and length
+struct FRAM_PREF_DIR {
+  uint32_t type;
+  uint16_t length;
+  uint16_t addr;
+};
+
+//  after the data: checksum, pool records add the epoch
+static const uint8_t FRAM_PREF_TRAILER_MAX = 4;
+
+//  changed ranges written by one save(), more are merged into the last
+static const uint8_t FRAM_PREF_SAVE_RUNS = 8;
+
+class FRAM_PREF;
+
+//  the pref record is its own backend, no extra allocation per pref
+class FRAMPreferenceBackend : public ESPPreferenceBackend, public PREF_STRUCT {
+  public:
+    FRAMPreferenceBackend(const PREF_STRUCT & pref) : PREF_STRUCT(pref) {}
+    
+    bool save(const uint8_t *data, size_t len) override;
+    bool load(uint8_t *data, size_t len) override;
+  
+  protected:
+    friend class FRAM_PREF;
+    
+    uint8_t trailer_(const uint8_t *data, size_t len, uint8_t *trailer);
+    uint8_t diff_(uint16_t addr, const uint8_t *data, size_t len, uint8_t *trailer, uint8_t tlen, const uint8_t *shadow, fram::FRAM_SEGMENT *segs);
+    uint64_t digest_(const uint8_t *data, size_t len);
+    bool load_(uint8_t *data, size_t len);
+    uint16_t checksum_(uint8_t *data, size_t len);
+    
+    //  one fram_pref per device
+    static FRAM_PREF * comp_;
+};
+
 class FRAM_PREF : public Component, public ESPPreferences {
   public:
     FRAM_PREF(fram::FRAM * fram);
     
     void set_pool(uint16_t pool_size, uint16_t pool_start);
-    void set_static_pref(std::string key, uint16_t addr, uint16_t size, std::function<uint32_t()> && fn, bool persist_key);
+    void set_static_pref(const char * key, uint16_t addr, uint16_t size, std::function<uint32_t()> && fn, bool persist_key);
+    void set_static_table(const FRAM_PREF_STATIC * table, uint16_t count);
+    void set_shadow(bool enabled, bool keep) { this->shadow_enabled_ = enabled; this->shadow_keep_ = keep; }
     
     void setup() override;
+    void loop() override;
     void dump_config() override;
     float get_setup_priority() const override { return setup_priority::BUS; }
     
@@ -45,17 +117,64 @@ class FRAM_PREF : public Component, public ESPPreferences {
     friend class FRAMPreferenceBackend;
     
     bool _check();
-    void _clear();
+    //  prefs_ index of a static pref, -1 if none
+    int32_t _static_find(uint32_t type);
+    
+    //  pool and static regions read at boot, load() is served from here
+    void _shadow_load();
+    void _shadow_release();
+    uint8_t * _shadow(uint16_t addr, uint16_t len);
+    
+    //  directory entries found by type and length, in any call order
+    uint32_t _pool_magic();
+    int32_t _pool_find(uint32_t type, uint16_t length);
+    int32_t _pool_add(uint32_t type, uint16_t length);
+    uint16_t _pool_alloc(uint16_t size);
+    bool _pool_reclaim();
+    //  records that did not fit at boot, after reclaiming
+    void _pool_pending();
     
     fram::FRAM * fram_;
     uint16_t pool_size_{0};
     uint16_t pool_start_{0};
-    uint16_t pool_next_{0};
     bool pool_cleared_{false};
+    uint16_t pool_epoch_{0};
+    uint16_t pool_reclaimed_{0};
+    uint16_t pool_pending_{0};
+    //  by address, high to low, directory order on FRAM does not matter
+    std::vector<FRAM_PREF_DIR> pool_dir_;
+    //  requested since boot, the others are reclaimed when space runs out
+    std::vector<bool> pool_claimed_;
+    
+    //  shown in dump_config() to compare boot cost
+    uint32_t setup_us_{0};
+#ifdef USE_FRAM_STATS
+    uint32_t setup_transactions_{0};
+    uint32_t setup_bytes_{0};
+#endif
+    uint16_t loads_shadow_{0};
+    uint16_t loads_fram_{0};
+    uint32_t loads_us_{0};
+    
+    bool shadow_enabled_{true};
+    bool shadow_keep_{false};
+    bool shadow_released_{false};
+    //  set on the first loop(), all components are set up
+    bool booted_{false};
+    //  pool records first, then static regions in address order
+    std::vector<uint8_t> shadow_;
+    uint16_t shadow_pool_addr_{0};
+    uint16_t shadow_pool_{0};
+    std::vector<fram::FRAM_SEGMENT> shadow_static_;
     
-    std::vector<PREF_STRUCT> prefs_;
-    std::vector<std::function<uint32_t()>> prefs_static_cb_;
-    std::map<uint32_t,uint8_t> prefs_static_map_;
+    //  grows in chunks, backends returned by make_preference() stay valid
+    std::deque<FRAMPreferenceBackend> prefs_;
+    //  table entries are first in prefs_
+    const FRAM_PREF_STATIC * static_table_{nullptr};
+    uint16_t static_table_cnt_{0};
+    //  static prefs with a lambda, hashed in setup() and sorted
+    std::vector<std::pair<uint16_t,std::function<uint32_t()>>> prefs_static_cb_;
+    std::vector<std::pair<uint32_t,uint16_t>> prefs_static_;
     
     ESPPreferences * pref_prev_;
 };
@@ -1,7 +1,10 @@
+import logging
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.components import fram
 from esphome.const import CONF_ID, CONF_LAMBDA, CONF_KEY, CONF_SIZE
+from esphome.helpers import cpp_string_escape
 
 DEPENDENCIES = ["fram"]
 CONF_FRAM_ID = "fram_id"
@@ -10,18 +13,48 @@ CONF_POOL_START = "pool_start"
 CONF_STATIC_PREFS = "static_prefs"
 CONF_ADDR = "addr"
 CONF_PERSIST_KEY = "persist_key"
+CONF_BOOT_SHADOW = "boot_shadow"
+CONF_KEEP_SHADOW = "keep_shadow"
+CONF_OBJECT_ID = "object_id"
+CONF_HASH = "hash"
+
+# as in FRAM_PREF.h
+FLAG_STATIC = 0b00000001
+FLAG_PERSIST_KEY = 0b00000010
 
 fram_pref_ns = cg.esphome_ns.namespace("fram_pref")
 FRAMPREFComponent = fram_pref_ns.class_("FRAM_PREF", cg.Component, cg.esphome_ns.class_("ESPPreferences"))
 
+_LOGGER = logging.getLogger(__name__)
+
+# same as fnv1_hash() in esphome/core/helpers.cpp
+def fnv1_hash(string):
+    hash = 2166136261
+    
+    for c in string.encode():
+        hash = (hash * 16777619) & 0xFFFFFFFF
+        hash ^= c
+    
+    return hash
+
+# hash in the make_preference() call, None if only a lambda knows it
+def static_pref_hash(conf_pref):
+    if CONF_HASH in conf_pref:
+        return conf_pref[CONF_HASH]
+    if CONF_OBJECT_ID in conf_pref:
+        return fnv1_hash(conf_pref[CONF_OBJECT_ID])
+    return None
+
 def validate_pref_range(conf_pref):
     f = validate_pref_range;
     
     if conf_pref[CONF_KEY] in f.keys:
         raise cv.Invalid(f"key \"{conf_pref[CONF_KEY]}\" already used")
     
-    if len(conf_pref.keys() & {CONF_ADDR, CONF_SIZE}) == 1:
-        raise cv.Invalid(f"Add both \"{CONF_ADDR}\" and \"{CONF_SIZE}\" or none")
+    f.keys.add(conf_pref[CONF_KEY])
+    
+    if CONF_ADDR in conf_pref and CONF_SIZE not in conf_pref:
+        raise cv.Invalid(f"Add \"{CONF_SIZE}\" with \"{CONF_ADDR}\"")
     
     if CONF_ADDR not in conf_pref:
         return conf_pref;
@@ -30,7 +63,6 @@ def validate_pref_range(conf_pref):
         raise cv.Invalid(f"Preference overlaps with previous (end address {f.range_min-1})")
     
     f.range_min = conf_pref[CONF_ADDR] + conf_pref[CONF_SIZE]
-    f.keys.add(conf_pref[CONF_KEY])
     conf_pref["_pref_addr"] = f"{conf_pref[CONF_ADDR]} - {f.range_min-1}"
     
     return conf_pref
@@ -46,10 +78,15 @@ def final_validate(config):
     if CONF_POOL_SIZE not in config and CONF_POOL_START in config:
         raise cv.Invalid(f"Either remove \"{CONF_POOL_START}\" or set \"{CONF_POOL_SIZE}\"")
     
+    # address ranges taken, end exclusive
+    used = []
+    hashes = set()
+    
     if CONF_POOL_SIZE in config:
         pool_start = config[CONF_POOL_START] if CONF_POOL_START in config else 0
         pool_end = pool_start + config[CONF_POOL_SIZE] - 1
         config["_pool_addr"] = f"{pool_start} - {pool_end}"
+        used.append((pool_start, pool_end + 1))
         
         if CONF_STATIC_PREFS in config:
           errors = []
@@ -65,27 +102,94 @@ def final_validate(config):
           
           if errors: raise cv.MultipleInvalid(errors)
     
+    for conf_pref in config.get(CONF_STATIC_PREFS, []):
+        hash = static_pref_hash(conf_pref)
+        
+        if hash is not None and hash in hashes:
+            raise cv.Invalid(f"{CONF_STATIC_PREFS} key \"{conf_pref[CONF_KEY]}\" has the same hash as another (0x{hash:08X})")
+        hashes.add(hash)
+        
+        if CONF_ADDR in conf_pref:
+            used.append((conf_pref[CONF_ADDR], conf_pref[CONF_ADDR] + conf_pref[CONF_SIZE]))
+    
+    # size without addr, the first gap around the pool and the prefs with addr,
+    # then the ones before it in the list. not stable: a change of the pool,
+    # of a size, an addr or the list order above it moves the pref
+    for conf_pref in config.get(CONF_STATIC_PREFS, []):
+        if CONF_SIZE not in conf_pref or CONF_ADDR in conf_pref: continue
+        
+        size = conf_pref[CONF_SIZE]
+        addr = 0
+        
+        for start, end in sorted(used):
+            if addr + size <= start: break
+            addr = max(addr, end)
+        
+        if addr + size > 65536:
+            raise cv.Invalid(f"No room for {CONF_STATIC_PREFS} key \"{conf_pref[CONF_KEY]}\" of {size} bytes")
+        
+        conf_pref[CONF_ADDR] = addr
+        conf_pref["_pref_addr"] = f"{addr} - {addr+size-1} (auto)"
+        used.append((addr, addr + size))
+        
+        _LOGGER.warning(f"{CONF_STATIC_PREFS} key \"{conf_pref[CONF_KEY]}\" placed at {addr} - {addr+size-1}, "
+            f"it moves and loses its data when the pool or other preferences change, set \"{CONF_ADDR}: {addr}\" to keep it there")
+    
     return config
 
 CONFIG_SCHEMA_ = cv.Schema({
     cv.GenerateID(): cv.declare_id(FRAMPREFComponent),
     cv.GenerateID(CONF_FRAM_ID): cv.use_id(fram.FRAMComponent),
-    cv.Optional(CONF_POOL_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=7,max=65536)),
-    cv.Optional(CONF_POOL_START): cv.int_range(min=0,max=65528),
+    cv.Optional(CONF_POOL_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=21,max=65536)),
+    cv.Optional(CONF_POOL_START): cv.int_range(min=0,max=65515),
+    cv.Optional(CONF_BOOT_SHADOW, default=True): cv.boolean,
+    cv.Optional(CONF_KEEP_SHADOW, default=False): cv.boolean,
     cv.Optional(CONF_STATIC_PREFS): cv.ensure_list(
         {
             cv.Required(CONF_KEY): cv.string_strict,
-            cv.Required(CONF_LAMBDA): cv.returning_lambda,
+            cv.Optional(CONF_LAMBDA): cv.returning_lambda,
+            cv.Optional(CONF_OBJECT_ID): cv.string_strict,
+            cv.Optional(CONF_HASH): cv.hex_uint32_t,
             cv.Optional(CONF_ADDR): cv.int_range(min=0,max=65533),
             cv.Optional(CONF_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=3,max=65536)),
             cv.Optional(CONF_PERSIST_KEY, default=False): cv.boolean
         },
+        cv.has_exactly_one_key(CONF_LAMBDA, CONF_OBJECT_ID, CONF_HASH),
         validate_pref_range
     )
 }).extend(cv.COMPONENT_SCHEMA)
 
 CONFIG_SCHEMA = final_validate
 
+# the fram size is known only with the full config, if set
+def validate_fram_size(config):
+    full_config = fv.full_config.get()
+    fram_path = full_config.get_path_for_id(config[CONF_FRAM_ID])[:-1]
+    fram_conf = full_config.get_config_for_path(fram_path)
+    
+    if CONF_SIZE not in fram_conf:
+        return config
+    
+    fram_size = fram_conf[CONF_SIZE]
+    errors = []
+    
+    if CONF_POOL_SIZE in config:
+        pool_start = config[CONF_POOL_START] if CONF_POOL_START in config else 0
+        if pool_start + config[CONF_POOL_SIZE] > fram_size:
+            errors.append(cv.Invalid(f"Pool ({config['_pool_addr']}) does not fit in FRAM of {fram_size} bytes"))
+    
+    for conf_pref in config.get(CONF_STATIC_PREFS, []):
+        if CONF_ADDR not in conf_pref: continue
+        
+        if conf_pref[CONF_ADDR] + conf_pref[CONF_SIZE] > fram_size:
+            errors.append(cv.Invalid(f"{CONF_STATIC_PREFS} key \"{conf_pref[CONF_KEY]}\" ({conf_pref['_pref_addr']}) does not fit in FRAM of {fram_size} bytes"))
+    
+    if errors: raise cv.MultipleInvalid(errors)
+    
+    return config
+
+FINAL_VALIDATE_SCHEMA = validate_fram_size
+
 async def to_code(config):
     fram = await cg.get_variable(config[CONF_FRAM_ID])
     pool_size = config[CONF_POOL_SIZE] if CONF_POOL_SIZE in config else 0
@@ -97,7 +201,32 @@ async def to_code(config):
     if pool_size:
         cg.add(var.set_pool(pool_size, pool_start))
     
+    cg.add(var.set_shadow(config[CONF_BOOT_SHADOW], config[CONF_KEEP_SHADOW]))
+    
+    # hashes known now go in a sorted table in flash,
+    # before set_static_pref(), table index is pref index
+    table = []
+    
     for conf_pref in config.get(CONF_STATIC_PREFS, []):
+        hash = static_pref_hash(conf_pref)
+        if hash is None: continue
+        
+        addr = conf_pref[CONF_ADDR] if CONF_ADDR in conf_pref else 0
+        size = conf_pref[CONF_SIZE] if CONF_SIZE in conf_pref else 0
+        flags = FLAG_STATIC | (FLAG_PERSIST_KEY if conf_pref[CONF_PERSIST_KEY] else 0)
+        
+        table.append((hash, addr, size, flags, conf_pref[CONF_KEY]))
+    
+    if table:
+        table_id = f"{config[CONF_ID]}_static_table"
+        rows = ",\n".join(f"  {{0x{hash:08X}, {addr}, {size}, {flags}, {cpp_string_escape(key)}}}" for hash, addr, size, flags, key in sorted(table))
+        
+        cg.add_global(cg.RawStatement(f"static constexpr esphome::fram_pref::FRAM_PREF_STATIC {table_id}[] = {{\n{rows}\n}};"))
+        cg.add(var.set_static_table(cg.RawExpression(table_id), len(table)))
+    
+    for conf_pref in config.get(CONF_STATIC_PREFS, []):
+        if CONF_LAMBDA not in conf_pref: continue
+        
         lambda_ = await cg.process_lambda(conf_pref[CONF_LAMBDA], [], return_type=cg.uint32)
         
         addr = conf_pref[CONF_ADDR] if CONF_ADDR in conf_pref else 0
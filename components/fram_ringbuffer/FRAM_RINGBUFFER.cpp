@@ -0,0 +1,301 @@
+#include "FRAM_RINGBUFFER.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+
+namespace esphome {
+namespace fram_ringbuffer {
+
+static const char * const TAG = "fram_ringbuffer";
+//  fram::FRAM::write() takes 16 bit sizes
+static const uint32_t FRAM_RINGBUFFER_CHUNK = 0x8000;
+
+
+void FRAM_RINGBUFFER::setRegion(uint32_t memaddr, uint32_t size)
+{
+  this->_start = memaddr;
+  this->_size = size - FRAM_RINGBUFFER_HEADER_SIZE;
+}
+
+
+void FRAM_RINGBUFFER::setup()
+{
+  if (!this->_load())
+  {
+    ESP_LOGW(TAG, "No valid pointers at 0x%x, starting empty", this->_start);
+    this->wipe();
+  }
+}
+
+
+void FRAM_RINGBUFFER::loop()
+{
+  if (this->_dirty && (millis() - this->_dirtySince >= this->_saveInterval))
+  {
+    this->save();
+  }
+}
+
+
+void FRAM_RINGBUFFER::dump_config()
+{
+  ESP_LOGCONFIG(TAG, "FRAM ring buffer:");
+  ESP_LOGCONFIG(TAG, "  Region: %u - %u", this->_start, this->_start + FRAM_RINGBUFFER_HEADER_SIZE + this->_size - 1);
+
+  if (this->_recordSize) {
+    ESP_LOGCONFIG(TAG, "  Records: fixed, %u bytes", this->_recordSize);
+  } else {
+    ESP_LOGCONFIG(TAG, "  Records: variable");
+  }
+
+  ESP_LOGCONFIG(TAG, "  Used: %u records, %u of %u bytes", this->_count, this->_used, this->_size);
+  ESP_LOGCONFIG(TAG, "  Save interval: %ums, saves: %u", this->_saveInterval, this->_saves);
+}
+
+
+bool FRAM_RINGBUFFER::push(const void * record, uint16_t size)
+{
+  uint32_t bytes = this->_recordBytes(size);
+  if (this->free() < bytes) return false;
+  if (this->_sinceSave + bytes > this->_size) this->save();
+
+  if (this->_recordSize)
+  {
+    this->_write(this->_head, (const uint8_t *)record, bytes);
+  }
+  else
+  {
+    this->_write(this->_head, (const uint8_t *)&size, 2);
+    this->_write((this->_head + 2) % this->_size, (const uint8_t *)record, size);
+  }
+
+  this->_pushed(bytes, 1);
+  return true;
+}
+
+
+int32_t FRAM_RINGBUFFER::pop(void * record, uint16_t buflen)
+{
+  int32_t size = this->peek(record, buflen);
+  if (size >= 0) this->_popped(this->_recordBytes(size), 1);
+  return size;
+}
+
+
+int32_t FRAM_RINGBUFFER::peek(void * record, uint16_t buflen)
+{
+  if (this->empty()) return -1;
+
+  if (this->_recordSize)
+  {
+    if (buflen < this->_recordSize) return -1;
+    this->_read(this->_tail, (uint8_t *)record, this->_recordSize);
+    return this->_recordSize;
+  }
+
+  uint16_t size;
+  this->_read(this->_tail, (uint8_t *)&size, 2);
+  if (buflen < size) return -1;
+  this->_read((this->_tail + 2) % this->_size, (uint8_t *)record, size);
+  return size;
+}
+
+
+bool FRAM_RINGBUFFER::pushMany(const void * records, uint32_t count)
+{
+  const uint8_t * p = (const uint8_t *)records;
+  uint32_t bytes = 0;
+
+  if (this->_recordSize)
+  {
+    bytes = count * this->_recordSize;
+  }
+  else
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      uint16_t size;
+      memcpy(&size, p + bytes, 2);
+      bytes += size + 2;
+      if (bytes > this->free()) return false;
+    }
+  }
+
+  if (bytes > this->free()) return false;
+  if (this->_sinceSave + bytes > this->_size) this->save();
+
+  this->_write(this->_head, p, bytes);
+  this->_pushed(bytes, count);
+  return true;
+}
+
+
+uint32_t FRAM_RINGBUFFER::popMany(void * records, uint32_t buflen)
+{
+  uint8_t * p = (uint8_t *)records;
+  uint32_t bytes;
+  uint32_t count = 0;
+
+  if (this->_recordSize)
+  {
+    count = std::min(this->_count, buflen / this->_recordSize);
+    bytes = count * this->_recordSize;
+    this->_read(this->_tail, p, bytes);
+  }
+  else
+  {
+    //  read ahead, then keep the whole records
+    uint32_t avail = std::min(this->_used, buflen);
+    this->_read(this->_tail, p, avail);
+    bytes = 0;
+    while (bytes + 2 <= avail)
+    {
+      uint16_t size;
+      memcpy(&size, p + bytes, 2);
+      if (bytes + 2 + size > avail) break;
+      bytes += size + 2;
+      count++;
+    }
+  }
+
+  if (count) this->_popped(bytes, count);
+  return count;
+}
+
+
+void FRAM_RINGBUFFER::save()
+{
+  if (!this->_dirty) return;
+
+  FRAM_RINGBUFFER_HEADER header{++this->_seq, this->_head, this->_tail, this->_used, this->_count, 0};
+  header.check = this->_check(header);
+
+  //  the write buffer flushes in address order: records must be on the
+  //  chip before the header that holds them, and the header before
+  //  pushes that overwrite records it dropped
+  this->_fram->flush();
+  this->_slot = this->_seq % FRAM_RINGBUFFER_SLOTS;
+  this->_fram->writeObject(this->_start + this->_slot * sizeof(header), header);
+  this->_fram->flush();
+
+  this->_sinceSave = this->_used;
+  this->_dirty = false;
+  this->_saves++;
+}
+
+
+void FRAM_RINGBUFFER::wipe()
+{
+  this->_head = 0;
+  this->_tail = 0;
+  this->_used = 0;
+  this->_count = 0;
+  this->_dirty = true;
+  this->save();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// FRAM_RINGBUFFER PROTECTED
+//
+
+bool FRAM_RINGBUFFER::_load()
+{
+  bool found = false;
+
+  for (uint8_t slot = 0; slot < FRAM_RINGBUFFER_SLOTS; slot++)
+  {
+    FRAM_RINGBUFFER_HEADER header;
+    this->_fram->readObject(this->_start + slot * sizeof(header), header);
+
+    if (header.check != this->_check(header)) continue;
+    if (header.head >= this->_size || header.tail >= this->_size || header.used > this->_size) continue;
+    if ((header.tail + header.used) % this->_size != header.head) continue;
+    if (found && header.seq < this->_seq) continue;
+
+    this->_seq = header.seq;
+    this->_slot = slot;
+    this->_head = header.head;
+    this->_tail = header.tail;
+    this->_used = header.used;
+    this->_count = header.count;
+    found = true;
+  }
+
+  this->_sinceSave = this->_used;
+  return found;
+}
+
+
+//  FNV-1a over the header words and the layout, so a changed
+//  size or record_size does not load old pointers
+uint32_t FRAM_RINGBUFFER::_check(const FRAM_RINGBUFFER_HEADER & header)
+{
+  const uint32_t words[] = {header.seq, header.head, header.tail, header.used, header.count,
+    this->_size, this->_recordSize};
+  uint32_t hash = 0x811C9DC5;
+  for (uint32_t w : words)
+  {
+    hash = (hash ^ w) * 0x01000193;
+  }
+  return hash;
+}
+
+
+void FRAM_RINGBUFFER::_touch()
+{
+  if (this->_dirty) return;
+  this->_dirty = true;
+  this->_dirtySince = millis();
+}
+
+
+void FRAM_RINGBUFFER::_write(uint32_t pos, const uint8_t * obj, uint32_t size)
+{
+  uint32_t base = this->_start + FRAM_RINGBUFFER_HEADER_SIZE;
+  while (size)
+  {
+    uint32_t len = std::min(std::min(size, this->_size - pos), FRAM_RINGBUFFER_CHUNK);
+    this->_fram->write(base + pos, (uint8_t *)obj, len);
+    pos = (pos + len) % this->_size;
+    obj += len;
+    size -= len;
+  }
+}
+
+
+void FRAM_RINGBUFFER::_read(uint32_t pos, uint8_t * obj, uint32_t size)
+{
+  uint32_t base = this->_start + FRAM_RINGBUFFER_HEADER_SIZE;
+  while (size)
+  {
+    uint32_t len = std::min(std::min(size, this->_size - pos), FRAM_RINGBUFFER_CHUNK);
+    this->_fram->read(base + pos, obj, len);
+    pos = (pos + len) % this->_size;
+    obj += len;
+    size -= len;
+  }
+}
+
+
+void FRAM_RINGBUFFER::_pushed(uint32_t bytes, uint32_t count)
+{
+  this->_head = (this->_head + bytes) % this->_size;
+  this->_used += bytes;
+  this->_count += count;
+  this->_sinceSave += bytes;
+  this->_touch();
+}
+
+
+void FRAM_RINGBUFFER::_popped(uint32_t bytes, uint32_t count)
+{
+  this->_tail = (this->_tail + bytes) % this->_size;
+  this->_used -= bytes;
+  this->_count -= count;
+  this->_touch();
+}
+
+}  // namespace fram_ringbuffer
+}  // namespace esphome
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/fram/FRAM.h"
+
+namespace esphome {
+namespace fram_ringbuffer {
+
+//  pointers, kept in two slots at the start of the region,
+//  the one with the higher seq and a valid check is loaded
+struct FRAM_RINGBUFFER_HEADER {
+  uint32_t seq;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t used;
+  uint32_t count;
+  uint32_t check;
+};
+
+static const uint8_t FRAM_RINGBUFFER_SLOTS = 2;
+static const uint32_t FRAM_RINGBUFFER_HEADER_SIZE = FRAM_RINGBUFFER_SLOTS * sizeof(FRAM_RINGBUFFER_HEADER);
+
+//  FIFO in a FRAM region
+//  record_size > 0: fixed size records
+//  record_size = 0: variable records, stored as uint16_t length + data
+class FRAM_RINGBUFFER : public Component
+{
+public:
+  FRAM_RINGBUFFER(fram::FRAM * fram) : _fram(fram) {}
+
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  void on_shutdown() override { this->save(); };
+  float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+  void     setRegion(uint32_t memaddr, uint32_t size);
+  void     setRecordSize(uint16_t size) { this->_recordSize = size; };
+  void     setSaveInterval(uint32_t ms) { this->_saveInterval = ms; };
+
+  //  single records, size is only used for variable records
+  bool     push(const void * record, uint16_t size = 0);
+  //  returns record size, -1 if empty or record does not fit in buflen
+  int32_t  pop(void * record, uint16_t buflen);
+  int32_t  peek(void * record, uint16_t buflen);
+
+  //  batches, at most two FRAM transfers (one at wrap)
+  //  variable records are packed in the buffer as in FRAM: uint16_t length + data
+  //  pushMany() adds all or none of count records
+  bool     pushMany(const void * records, uint32_t count);
+  //  pops the whole records that fit in buflen bytes, returns their count
+  uint32_t popMany(void * records, uint32_t buflen);
+
+  uint32_t count() { return this->_count; };
+  bool     empty() { return this->_count == 0; };
+  //  true when a record of size can not be pushed
+  bool     full(uint16_t size = 0) { return this->free() < this->_recordBytes(size); };
+  //  bytes of data area
+  uint32_t size() { return this->_size; };
+  uint32_t free() { return this->_size - this->_used; };
+
+  //  pointers are written after save_interval, before pushed records
+  //  overwrite what the last save still holds and on shutdown
+  void     save();
+  bool     isSaved() { return !this->_dirty; };
+  //  drop all records
+  void     wipe();
+
+protected:
+  fram::FRAM * _fram;
+  uint32_t _start{0};
+  uint32_t _size{0};
+  uint16_t _recordSize{0};
+  uint32_t _saveInterval{1000};
+
+  uint32_t _head{0};
+  uint32_t _tail{0};
+  uint32_t _used{0};
+  uint32_t _count{0};
+
+  uint32_t _seq{0};
+  uint8_t  _slot{0};
+  //  bytes from the saved tail to head, the saved records
+  //  and those pushed after them
+  uint32_t _sinceSave{0};
+  bool     _dirty{false};
+  uint32_t _dirtySince{0};
+  uint32_t _saves{0};
+
+  bool     _load();
+  uint32_t _check(const FRAM_RINGBUFFER_HEADER & header);
+  uint32_t _recordBytes(uint16_t size) { return this->_recordSize ? this->_recordSize : size + 2; };
+  void     _touch();
+  //  wrap around the data area, at most two transfers
+  void     _write(uint32_t pos, const uint8_t * obj, uint32_t size);
+  void     _read(uint32_t pos, uint8_t * obj, uint32_t size);
+  void     _pushed(uint32_t bytes, uint32_t count);
+  void     _popped(uint32_t bytes, uint32_t count);
+};
+
+}  // namespace fram_ringbuffer
+}  // namespace esphome
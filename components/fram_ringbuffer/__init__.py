@@ -0,0 +1,47 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import fram
+from esphome.const import CONF_ID, CONF_SIZE
+
+DEPENDENCIES = ["fram"]
+MULTI_CONF = True
+CONF_FRAM_ID = "fram_id"
+CONF_START = "start"
+CONF_RECORD_SIZE = "record_size"
+CONF_SAVE_INTERVAL = "save_interval"
+
+fram_ringbuffer_ns = cg.esphome_ns.namespace("fram_ringbuffer")
+FRAMRingBufferComponent = fram_ringbuffer_ns.class_("FRAM_RINGBUFFER", cg.Component)
+
+# two pointer slots of 24 bytes go before the data
+HEADER_SIZE = 48
+
+def validate_records(config):
+    data_size = config[CONF_SIZE] - HEADER_SIZE
+    record_size = config.get(CONF_RECORD_SIZE, 2)
+    
+    if record_size > data_size:
+        raise cv.Invalid(f"{CONF_RECORD_SIZE} {record_size} does not fit in {data_size} bytes of data ({CONF_SIZE} - {HEADER_SIZE})")
+    
+    return config
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
+    cv.GenerateID(): cv.declare_id(FRAMRingBufferComponent),
+    cv.GenerateID(CONF_FRAM_ID): cv.use_id(fram.FRAMComponent),
+    cv.Optional(CONF_START, default=0): cv.int_range(min=0),
+    cv.Required(CONF_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=64)),
+    cv.Optional(CONF_RECORD_SIZE): cv.int_range(min=1,max=65535),
+    cv.Optional(CONF_SAVE_INTERVAL, default="1s"): cv.positive_time_period_milliseconds
+}).extend(cv.COMPONENT_SCHEMA), validate_records)
+
+async def to_code(config):
+    fram = await cg.get_variable(config[CONF_FRAM_ID])
+    
+    var = cg.new_Pvariable(config[CONF_ID], fram)
+    await cg.register_component(var, config)
+    
+    cg.add(var.setRegion(config[CONF_START], config[CONF_SIZE]))
+    cg.add(var.setSaveInterval(config[CONF_SAVE_INTERVAL]))
+    
+    if CONF_RECORD_SIZE in config:
+        cg.add(var.setRecordSize(config[CONF_RECORD_SIZE]))
@@ -0,0 +1,305 @@
+#include "FRAM_TIMESERIES.h"
+#include "esphome/core/log.h"
+#include <cmath>
+
+namespace esphome {
+namespace fram_timeseries {
+
+static const char * const TAG = "fram_timeseries";
+
+
+//  MSB first, as written by _putBits()
+struct FRAM_TIMESERIES_READER {
+  const uint8_t * data;
+  uint32_t pos;
+
+  uint32_t get(uint8_t bits)
+  {
+    uint32_t value = 0;
+    while (bits--)
+    {
+      value = (value << 1) | ((this->data[this->pos >> 3] >> (7 - (this->pos & 7))) & 1);
+      this->pos++;
+    }
+    return value;
+  }
+};
+
+
+void FRAM_TIMESERIES::setRegion(uint32_t memaddr, uint32_t size)
+{
+  this->_start = memaddr;
+  this->_size = size;
+}
+
+
+void FRAM_TIMESERIES::setSensor(sensor::Sensor * sensor)
+{
+  sensor->add_on_state_callback([this](float value) {
+    if (std::isnan(value)) return;
+    auto now = this->_time->now();
+    if (!now.is_valid()) return;
+    this->add(now.timestamp, value);
+  });
+}
+
+
+void FRAM_TIMESERIES::setup()
+{
+  uint16_t blocks = this->_size / this->_blockSize;
+  this->_index.assign(blocks, FRAM_TIMESERIES_SPAN{0, 0, 0, 0});
+  this->_block.assign(this->_blockSize, 0);
+
+  //  the newest block is the one with the highest seq
+  bool found = false;
+  for (uint16_t i = 0; i < blocks; i++)
+  {
+    FRAM_TIMESERIES_HEADER header;
+    this->_fram->readObject(this->_start + i * this->_blockSize + this->_dataBytes(), header);
+
+    if (header.check != this->_check(header) || !header.count) continue;
+    if (header.bits > this->_dataBytes() * 8) continue;
+
+    this->_index[i] = FRAM_TIMESERIES_SPAN{header.t_first, header.t_last, header.count, header.bits};
+
+    if (!found || header.seq >= this->_seq)
+    {
+      this->_seq = header.seq + 1;
+      this->_next = (i + 1) % blocks;
+      found = true;
+    }
+  }
+}
+
+
+void FRAM_TIMESERIES::dump_config()
+{
+  ESP_LOGCONFIG(TAG, "FRAM time series:");
+  ESP_LOGCONFIG(TAG, "  Region: %u - %u", this->_start, (uint32_t)(this->_start + this->_index.size() * this->_blockSize - 1));
+  ESP_LOGCONFIG(TAG, "  Blocks: %u of %u bytes", (unsigned)this->_index.size(), this->_blockSize);
+
+  uint16_t used = 0;
+  for (auto & span : this->_index) used += (span.count > 0);
+  uint32_t samples = this->getSamples();
+  if (samples) {
+    ESP_LOGCONFIG(TAG, "  Samples: %u in %u blocks, %.2f bytes per sample", samples, used,
+      (float)(used * this->_blockSize + this->_bits / 8) / samples);
+  }
+}
+
+
+void FRAM_TIMESERIES::add(uint32_t time, float value)
+{
+  //  blocks are in time order, clock moved back
+  if (this->_count && time < this->_tLast) this->_seal();
+  if (this->_bits + FRAM_TIMESERIES_MAX_BITS > this->_dataBytes() * 8) this->_seal();
+
+  uint32_t v;
+  memcpy(&v, &value, 4);
+
+  if (!this->_count)
+  {
+    this->_tFirst = time;
+    this->_delta = 0;
+    this->_lead = 0xFF;
+    this->_putBits(v, 32);
+  }
+  else
+  {
+    //  delta of delta: 0, 7, 9, 12 or 32 bits
+    int32_t delta = time - this->_tLast;
+    int32_t dod = delta - this->_delta;
+    this->_delta = delta;
+
+    if (dod == 0) {
+      this->_putBits(0b0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+      this->_putBits(0b10, 2);
+      this->_putBits(dod + 63, 7);
+    } else if (dod >= -255 && dod <= 256) {
+      this->_putBits(0b110, 3);
+      this->_putBits(dod + 255, 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+      this->_putBits(0b1110, 4);
+      this->_putBits(dod + 2047, 12);
+    } else {
+      this->_putBits(0b1111, 4);
+      this->_putBits(dod, 32);
+    }
+
+    //  XOR with previous: 0, or meaningful bits in the previous
+    //  window, or a new window (leading zeros, length)
+    uint32_t x = v ^ this->_value;
+    if (!x) {
+      this->_putBits(0b0, 1);
+    } else {
+      uint8_t lead = __builtin_clz(x);
+      uint8_t trail = __builtin_ctz(x);
+      if (this->_lead != 0xFF && lead >= this->_lead && trail >= this->_trail) {
+        this->_putBits(0b10, 2);
+        this->_putBits(x >> this->_trail, 32 - this->_lead - this->_trail);
+      } else {
+        uint8_t len = 32 - lead - trail;
+        this->_putBits(0b11, 2);
+        this->_putBits(lead, 5);
+        this->_putBits(len - 1, 5);
+        this->_putBits(x >> trail, len);
+        this->_lead = lead;
+        this->_trail = trail;
+      }
+    }
+  }
+
+  this->_value = v;
+  this->_tLast = time;
+  this->_count++;
+}
+
+
+void FRAM_TIMESERIES::flush()
+{
+  this->_seal();
+}
+
+
+uint32_t FRAM_TIMESERIES::query(uint32_t from, uint32_t to, FRAMSample && cb)
+{
+  uint32_t found = 0;
+  std::vector<uint8_t> data(this->_dataBytes());
+
+  for (uint16_t k = 0; k < this->_index.size(); k++)
+  {
+    uint16_t i = (this->_next + k) % this->_index.size();
+    auto & span = this->_index[i];
+    if (!span.count || span.t_last < from || span.t_first > to) continue;
+
+    //  only the bytes holding samples
+    this->_fram->read(this->_start + i * this->_blockSize, data.data(), (span.bits + 7) / 8);
+    found += this->_decode(data.data(), span.count, span.t_first, from, to, cb);
+  }
+
+  if (this->_count && this->_tLast >= from && this->_tFirst <= to)
+  {
+    found += this->_decode(this->_block.data(), this->_count, this->_tFirst, from, to, cb);
+  }
+  return found;
+}
+
+
+uint32_t FRAM_TIMESERIES::getSamples()
+{
+  uint32_t samples = this->_count;
+  for (auto & span : this->_index) samples += span.count;
+  return samples;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// FRAM_TIMESERIES PROTECTED
+//
+
+//  FNV-1a, with the block size so a changed layout is not loaded
+uint32_t FRAM_TIMESERIES::_check(const FRAM_TIMESERIES_HEADER & header)
+{
+  const uint32_t words[] = {header.seq, header.t_first, header.t_last,
+    header.count | ((uint32_t)header.bits << 16), this->_blockSize};
+  uint32_t hash = 0x811C9DC5;
+  for (uint32_t w : words)
+  {
+    hash = (hash ^ w) * 0x01000193;
+  }
+  return hash;
+}
+
+
+void FRAM_TIMESERIES::_putBits(uint32_t value, uint8_t bits)
+{
+  while (bits--)
+  {
+    if ((value >> bits) & 1) this->_block[this->_bits >> 3] |= 0x80 >> (this->_bits & 7);
+    this->_bits++;
+  }
+}
+
+
+//  the old header of a reused block is cleared first, then data and
+//  header in one write, header last. a torn write leaves no valid header.
+void FRAM_TIMESERIES::_seal()
+{
+  if (!this->_count) return;
+
+  uint32_t memaddr = this->_start + this->_next * this->_blockSize;
+  if (this->_index[this->_next].count)
+  {
+    FRAM_TIMESERIES_HEADER old{};
+    this->_fram->writeObject(memaddr + this->_dataBytes(), old);
+    //  the write buffer flushes in address order, the header is above the data
+    this->_fram->flush();
+  }
+
+  FRAM_TIMESERIES_HEADER header{this->_seq, this->_tFirst, this->_tLast, this->_count, this->_bits, 0};
+  header.check = this->_check(header);
+  memcpy(this->_block.data() + this->_dataBytes(), &header, sizeof(header));
+
+  this->_fram->write(memaddr, this->_block.data(), this->_blockSize);
+
+  this->_index[this->_next] = FRAM_TIMESERIES_SPAN{this->_tFirst, this->_tLast, this->_count, this->_bits};
+  this->_next = (this->_next + 1) % this->_index.size();
+  this->_seq++;
+
+  std::fill(this->_block.begin(), this->_block.end(), 0);
+  this->_bits = 0;
+  this->_count = 0;
+}
+
+
+uint32_t FRAM_TIMESERIES::_decode(const uint8_t * data, uint16_t count, uint32_t t_first,
+  uint32_t from, uint32_t to, FRAMSample & cb)
+{
+  FRAM_TIMESERIES_READER reader{data, 0};
+  uint32_t found = 0;
+  uint32_t time = t_first;
+  int32_t  delta = 0;
+  uint32_t value = reader.get(32);
+  uint8_t  lead = 0;
+  uint8_t  trail = 0;
+
+  for (uint16_t n = 0; n < count; n++)
+  {
+    if (n)
+    {
+      int32_t dod;
+      if (!reader.get(1)) dod = 0;
+      else if (!reader.get(1)) dod = (int32_t)reader.get(7) - 63;
+      else if (!reader.get(1)) dod = (int32_t)reader.get(9) - 255;
+      else if (!reader.get(1)) dod = (int32_t)reader.get(12) - 2047;
+      else dod = reader.get(32);
+      delta += dod;
+      time += delta;
+
+      if (reader.get(1))
+      {
+        if (reader.get(1))
+        {
+          lead = reader.get(5);
+          trail = 32 - lead - (reader.get(5) + 1);
+        }
+        value ^= reader.get(32 - lead - trail) << trail;
+      }
+    }
+
+    if (time > to) break;
+    if (time >= from)
+    {
+      float f;
+      memcpy(&f, &value, 4);
+      cb(time, f);
+      found++;
+    }
+  }
+  return found;
+}
+
+}  // namespace fram_timeseries
+}  // namespace esphome
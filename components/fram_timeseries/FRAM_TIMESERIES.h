@@ -0,0 +1,96 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/fram/FRAM.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/time/real_time_clock.h"
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace fram_timeseries {
+
+//  at the end of every block, written last, cleared before a block is reused
+struct FRAM_TIMESERIES_HEADER {
+  uint32_t seq;
+  uint32_t t_first;
+  uint32_t t_last;
+  uint16_t count;
+  uint16_t bits;
+  uint32_t check;
+};
+
+//  RAM index, one per block, count 0 if empty
+struct FRAM_TIMESERIES_SPAN {
+  uint32_t t_first;
+  uint32_t t_last;
+  uint16_t count;
+  uint16_t bits;
+};
+
+//  worst case sample: 4 + 32 bits time, 2 + 5 + 5 + 32 bits value
+static const uint8_t FRAM_TIMESERIES_MAX_BITS = 80;
+
+using FRAMSample = std::function<void(uint32_t time, float value)>;
+
+//  sensor history in a circular array of blocks,
+//  Gorilla compressed: delta of delta timestamps, XOR values.
+//  one block is filled in RAM and written when full.
+class FRAM_TIMESERIES : public Component
+{
+public:
+  FRAM_TIMESERIES(fram::FRAM * fram) : _fram(fram) {}
+
+  void setup() override;
+  void dump_config() override;
+  void on_shutdown() override { this->flush(); };
+  float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+  void     setRegion(uint32_t memaddr, uint32_t size);
+  void     setBlockSize(uint16_t size) { this->_blockSize = size; };
+  void     setTime(time::RealTimeClock * time) { this->_time = time; };
+  void     setSensor(sensor::Sensor * sensor);
+
+  //  time in seconds, not older than the last sample
+  void     add(uint32_t time, float value);
+  //  write the RAM block now, the next sample starts a new one
+  void     flush();
+  //  calls cb for samples from..to (inclusive), oldest first,
+  //  only blocks overlapping the range are read. returns samples found.
+  uint32_t query(uint32_t from, uint32_t to, FRAMSample && cb);
+
+  uint32_t getSamples();
+  uint16_t getBlocks() { return this->_index.size(); };
+
+protected:
+  fram::FRAM * _fram;
+  time::RealTimeClock * _time{nullptr};
+  uint32_t _start{0};
+  uint32_t _size{0};
+  uint16_t _blockSize{256};
+
+  std::vector<FRAM_TIMESERIES_SPAN> _index;
+  uint16_t _next{0};
+  uint32_t _seq{0};
+
+  //  block being filled
+  std::vector<uint8_t> _block;
+  uint16_t _bits{0};
+  uint16_t _count{0};
+  uint32_t _tFirst{0};
+  uint32_t _tLast{0};
+  int32_t  _delta{0};
+  uint32_t _value{0};
+  uint8_t  _lead{0xFF};
+  uint8_t  _trail{0};
+
+  uint16_t _dataBytes() { return this->_blockSize - sizeof(FRAM_TIMESERIES_HEADER); };
+  uint32_t _check(const FRAM_TIMESERIES_HEADER & header);
+  void     _putBits(uint32_t value, uint8_t bits);
+  void     _seal();
+  uint32_t _decode(const uint8_t * data, uint16_t count, uint32_t t_first,
+             uint32_t from, uint32_t to, FRAMSample & cb);
+};
+
+}  // namespace fram_timeseries
+}  // namespace esphome
@@ -0,0 +1,40 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import fram, sensor, time
+from esphome.const import CONF_ID, CONF_SIZE, CONF_SENSOR_ID, CONF_TIME_ID
+
+DEPENDENCIES = ["fram"]
+MULTI_CONF = True
+CONF_FRAM_ID = "fram_id"
+CONF_START = "start"
+CONF_BLOCK_SIZE = "block_size"
+
+fram_timeseries_ns = cg.esphome_ns.namespace("fram_timeseries")
+FRAMTimeSeriesComponent = fram_timeseries_ns.class_("FRAM_TIMESERIES", cg.Component)
+
+def validate_blocks(config):
+    if config[CONF_SIZE] < 2 * config[CONF_BLOCK_SIZE]:
+        raise cv.Invalid(f"\"{CONF_SIZE}\" must hold at least 2 blocks of {config[CONF_BLOCK_SIZE]} bytes")
+    
+    return config
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
+    cv.GenerateID(): cv.declare_id(FRAMTimeSeriesComponent),
+    cv.GenerateID(CONF_FRAM_ID): cv.use_id(fram.FRAMComponent),
+    cv.GenerateID(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+    cv.Required(CONF_SENSOR_ID): cv.use_id(sensor.Sensor),
+    cv.Optional(CONF_START, default=0): cv.int_range(min=0),
+    cv.Required(CONF_SIZE): fram.validate_bytes_1024,
+    cv.Optional(CONF_BLOCK_SIZE, default=256): cv.All(fram.validate_bytes_1024, cv.int_range(min=64,max=4096))
+}).extend(cv.COMPONENT_SCHEMA), validate_blocks)
+
+async def to_code(config):
+    fram = await cg.get_variable(config[CONF_FRAM_ID])
+    
+    var = cg.new_Pvariable(config[CONF_ID], fram)
+    await cg.register_component(var, config)
+    
+    cg.add(var.setRegion(config[CONF_START], config[CONF_SIZE]))
+    cg.add(var.setBlockSize(config[CONF_BLOCK_SIZE]))
+    cg.add(var.setTime(await cg.get_variable(config[CONF_TIME_ID])))
+    cg.add(var.setSensor(await cg.get_variable(config[CONF_SENSOR_ID])))
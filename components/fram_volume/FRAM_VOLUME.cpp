@@ -0,0 +1,204 @@
+#include "FRAM_VOLUME.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace fram_volume {
+
+static const char * const TAG = "fram_volume";
+//  fram::FRAM::write() takes 16 bit sizes
+static const uint32_t FRAM_VOLUME_CHUNK = 0x8000;
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+struct FRAM_VOLUME_TASK {
+  FRAM_VOLUME * volume;
+  uint8_t group;
+};
+#endif
+
+
+void FRAM_VOLUME::setMode(FRAM_VOLUME_MODE mode, uint32_t stripe_size)
+{
+  this->_mode = mode;
+  this->_stripeSize = stripe_size;
+}
+
+
+void FRAM_VOLUME::setup()
+{
+  this->_sizeBytes = 0;
+  this->_memberSize = 0xFFFFFFFF;
+
+  for (auto fram : this->_members)
+  {
+    uint32_t size = fram->getSizeBytes();
+    if (!size) ESP_LOGW(TAG, "Member 0x%x has size 0, set size in its config!", fram->get_i2c_address());
+    this->_memberSize = std::min(this->_memberSize, size);
+    this->_sizeBytes += size;
+  }
+
+  if (this->_mode == FRAM_VOLUME_STRIPE)
+  {
+    this->_memberSize -= this->_memberSize % this->_stripeSize;
+    this->_sizeBytes = this->_memberSize * this->_members.size();
+  }
+
+  //  members on the same bus go in the same group
+  std::vector<i2c::I2CBus *> buses;
+  for (auto fram : this->_members)
+  {
+    auto it = std::find(buses.begin(), buses.end(), fram->getBus());
+    this->_group.push_back(it - buses.begin());
+    if (it == buses.end()) buses.push_back(fram->getBus());
+  }
+  this->_groups = buses.size();
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+  if (this->_mode == FRAM_VOLUME_STRIPE && this->_groups > 1)
+  {
+    this->_groupDone = xQueueCreate(this->_groups, sizeof(uint8_t));
+    this->_groupStart.push_back(nullptr);
+    for (uint8_t g = 1; g < this->_groups; g++)
+    {
+      this->_groupStart.push_back(xQueueCreate(1, sizeof(uint8_t)));
+      xTaskCreatePinnedToCore(FRAM_VOLUME::_groupTask, "fram_volume", 3072,
+        new FRAM_VOLUME_TASK{this, g}, 5, nullptr, tskNO_AFFINITY);
+    }
+  }
+#endif
+}
+
+
+void FRAM_VOLUME::dump_config()
+{
+  ESP_LOGCONFIG(TAG, "FRAM volume:");
+  ESP_LOGCONFIG(TAG, "  Members: %u on %u bus(es)", (unsigned)this->_members.size(), this->_groups);
+
+  if (this->_mode == FRAM_VOLUME_STRIPE) {
+    ESP_LOGCONFIG(TAG, "  Mode: stripe, %u bytes", this->_stripeSize);
+  } else {
+    ESP_LOGCONFIG(TAG, "  Mode: concat");
+  }
+
+  ESP_LOGCONFIG(TAG, "  Size: %uKiB", this->_sizeBytes / 1024);
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+  if (!this->_groupStart.empty()) {
+    ESP_LOGCONFIG(TAG, "  Parallel transfers: yes");
+  }
+#endif
+}
+
+
+void FRAM_VOLUME::flush()
+{
+  for (auto fram : this->_members) fram->flush();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// FRAM_VOLUME PROTECTED
+//
+
+uint8_t FRAM_VOLUME::_locate(uint32_t memaddr, uint32_t & chipaddr, uint32_t & len)
+{
+  if (this->_mode == FRAM_VOLUME_STRIPE)
+  {
+    uint32_t stripe = memaddr / this->_stripeSize;
+    uint32_t offset = memaddr % this->_stripeSize;
+    uint8_t  n = this->_members.size();
+    chipaddr = (stripe / n) * this->_stripeSize + offset;
+    len = this->_stripeSize - offset;
+    return stripe % n;
+  }
+
+  uint8_t member = 0;
+  while (memaddr >= this->_members[member]->getSizeBytes())
+  {
+    memaddr -= this->_members[member]->getSizeBytes();
+    member++;
+  }
+  chipaddr = memaddr;
+  len = this->_members[member]->getSizeBytes() - memaddr;
+  return member;
+}
+
+
+void FRAM_VOLUME::_transfer(bool write, uint32_t memaddr, uint8_t * obj, uint32_t size)
+{
+  if (memaddr >= this->_sizeBytes || size > this->_sizeBytes - memaddr)
+  {
+    uint32_t keep = (memaddr >= this->_sizeBytes) ? 0 : this->_sizeBytes - memaddr;
+    ESP_LOGW(TAG, "%u bytes at %u past end of volume, %s", size, memaddr, keep ? "truncated" : "ignored");
+    //  reads past the end return zeros, not what obj held before
+    if (!write) memset(obj + keep, 0, size - keep);
+    size = keep;
+    if (!size) return;
+  }
+
+  FRAM_VOLUME_JOB job{write, memaddr, obj, size};
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+  //  worth it only when the transfer spans members on other buses
+  if (!this->_groupStart.empty() && size > this->_stripeSize)
+  {
+    std::lock_guard<std::mutex> lock(this->_jobLock);
+    this->_job = job;
+    uint8_t done;
+    for (uint8_t g = 1; g < this->_groups; g++) xQueueSend(this->_groupStart[g], &g, portMAX_DELAY);
+    this->_transferGroup(job, 0);
+    for (uint8_t g = 1; g < this->_groups; g++) xQueueReceive(this->_groupDone, &done, portMAX_DELAY);
+    return;
+  }
+#endif
+
+  for (uint8_t g = 0; g < this->_groups; g++) this->_transferGroup(job, g);
+}
+
+
+void FRAM_VOLUME::_transferGroup(const FRAM_VOLUME_JOB & job, uint8_t group)
+{
+  uint32_t memaddr = job.memaddr;
+  uint8_t * obj = job.obj;
+  uint32_t size = job.size;
+
+  while (size)
+  {
+    uint32_t chipaddr, len;
+    uint8_t member = this->_locate(memaddr, chipaddr, len);
+    len = std::min(std::min(len, size), FRAM_VOLUME_CHUNK);
+
+    if (this->_group[member] == group)
+    {
+      if (job.write) this->_members[member]->write(chipaddr, obj, len);
+      else this->_members[member]->read(chipaddr, obj, len);
+    }
+
+    memaddr += len;
+    obj += len;
+    size -= len;
+  }
+}
+
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+//  the calling task waits for all groups, so members are not used
+//  from loop() while a group task runs
+void FRAM_VOLUME::_groupTask(void * arg)
+{
+  FRAM_VOLUME_TASK * task = (FRAM_VOLUME_TASK *)arg;
+  FRAM_VOLUME * volume = task->volume;
+  uint8_t g;
+  while (true)
+  {
+    if (xQueueReceive(volume->_groupStart[task->group], &g, portMAX_DELAY) != pdTRUE) continue;
+    volume->_transferGroup(volume->_job, task->group);
+    xQueueSend(volume->_groupDone, &g, portMAX_DELAY);
+  }
+}
+#endif
+
+}  // namespace fram_volume
+}  // namespace esphome
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/component.h"
+#include "esphome/components/fram/FRAM.h"
+#include <vector>
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+#include <mutex>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#endif
+
+namespace esphome {
+namespace fram_volume {
+
+enum FRAM_VOLUME_MODE : uint8_t {
+  FRAM_VOLUME_CONCAT,
+  FRAM_VOLUME_STRIPE
+};
+
+//  one transfer, shared with the bus group tasks
+struct FRAM_VOLUME_JOB {
+  bool write;
+  uint32_t memaddr;
+  uint8_t * obj;
+  uint32_t size;
+};
+
+//  several FRAM chips as one address space
+//  concat: addresses continue on the next chip where the previous ends
+//  stripe: stripe size blocks go round robin over the chips
+class FRAM_VOLUME : public Component
+{
+public:
+  void setup() override;
+  void dump_config() override;
+  //  after the members have read their size
+  float get_setup_priority() const override { return setup_priority::DATA - 1.0f; }
+
+  void     addMember(fram::FRAM * fram) { this->_members.push_back(fram); };
+  void     setMode(FRAM_VOLUME_MODE mode, uint32_t stripe_size);
+
+  void     write8(uint32_t memaddr, uint8_t value) { this->_writeValue(memaddr, value); };
+  void     write16(uint32_t memaddr, uint16_t value) { this->_writeValue(memaddr, value); };
+  void     write32(uint32_t memaddr, uint32_t value) { this->_writeValue(memaddr, value); };
+  void     writeFloat(uint32_t memaddr, float value) { this->_writeValue(memaddr, value); };
+  void     writeDouble(uint32_t memaddr, double value) { this->_writeValue(memaddr, value); };
+  void     write(uint32_t memaddr, uint8_t * obj, uint32_t size) { this->_transfer(true, memaddr, obj, size); };
+
+  uint8_t  read8(uint32_t memaddr) { return this->_readValue<uint8_t>(memaddr); };
+  uint16_t read16(uint32_t memaddr) { return this->_readValue<uint16_t>(memaddr); };
+  uint32_t read32(uint32_t memaddr) { return this->_readValue<uint32_t>(memaddr); };
+  float    readFloat(uint32_t memaddr) { return this->_readValue<float>(memaddr); };
+  double   readDouble(uint32_t memaddr) { return this->_readValue<double>(memaddr); };
+  void     read(uint32_t memaddr, uint8_t * obj, uint32_t size) { this->_transfer(false, memaddr, obj, size); };
+
+  template <class T> uint32_t writeObject(uint32_t memaddr, T &obj)
+  {
+    this->write(memaddr, (uint8_t *) &obj, sizeof(obj));
+    return memaddr + sizeof(obj);
+  };
+  template <class T> uint32_t readObject(uint32_t memaddr, T &obj)
+  {
+    this->read(memaddr, (uint8_t *) &obj, sizeof(obj));
+    return memaddr + sizeof(obj);
+  }
+
+  //  Returns size of the volume in BYTE, 0 before setup()
+  uint32_t getSizeBytes() { return this->_sizeBytes; };
+  uint8_t  getMemberCount() { return this->_members.size(); };
+  //  flush write buffers of all members
+  void     flush();
+
+protected:
+  std::vector<fram::FRAM *> _members;
+  FRAM_VOLUME_MODE _mode{FRAM_VOLUME_CONCAT};
+  uint32_t _stripeSize{0};
+  //  usable bytes per member, the smallest chip in stripe mode
+  uint32_t _memberSize{0};
+  uint32_t _sizeBytes{0};
+
+  //  members sharing an I2C bus, group 0 runs in the calling task
+  std::vector<uint8_t> _group;
+  uint8_t  _groups{1};
+
+#ifdef USE_FRAM_VOLUME_PARALLEL
+  //  one parallel transfer at a time, _job is shared with the group tasks
+  std::mutex _jobLock;
+  FRAM_VOLUME_JOB _job;
+  std::vector<QueueHandle_t> _groupStart;
+  QueueHandle_t _groupDone{nullptr};
+  static void _groupTask(void * arg);
+#endif
+
+  //  member and its address for memaddr, len = bytes until the next member
+  uint8_t  _locate(uint32_t memaddr, uint32_t & chipaddr, uint32_t & len);
+  void     _transfer(bool write, uint32_t memaddr, uint8_t * obj, uint32_t size);
+  //  only the part of the job on members in group
+  void     _transferGroup(const FRAM_VOLUME_JOB & job, uint8_t group);
+
+  template <class T> void _writeValue(uint32_t memaddr, T value)
+  {
+    this->write(memaddr, (uint8_t *) &value, sizeof(T));
+  };
+  template <class T> T _readValue(uint32_t memaddr)
+  {
+    T value;
+    this->read(memaddr, (uint8_t *) &value, sizeof(T));
+    return value;
+  };
+};
+
+}  // namespace fram_volume
+}  // namespace esphome
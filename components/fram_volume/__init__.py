@@ -0,0 +1,48 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import fram
+from esphome.const import CONF_ID, CONF_MODE
+from esphome.core import CORE
+
+DEPENDENCIES = ["fram"]
+MULTI_CONF = True
+CONF_MEMBERS = "members"
+CONF_STRIPE_SIZE = "stripe_size"
+
+fram_volume_ns = cg.esphome_ns.namespace("fram_volume")
+FRAMVolumeComponent = fram_volume_ns.class_("FRAM_VOLUME", cg.Component)
+FRAMVolumeMode = fram_volume_ns.enum("FRAM_VOLUME_MODE")
+
+VOLUME_MODES = {
+    "concat": FRAMVolumeMode.FRAM_VOLUME_CONCAT,
+    "stripe": FRAMVolumeMode.FRAM_VOLUME_STRIPE
+}
+
+def validate_stripe(config):
+    if config[CONF_MODE] == "stripe" and CONF_STRIPE_SIZE not in config:
+        raise cv.Invalid(f"Set \"{CONF_STRIPE_SIZE}\" for stripe mode")
+    
+    if config[CONF_MODE] == "concat" and CONF_STRIPE_SIZE in config:
+        raise cv.Invalid(f"\"{CONF_STRIPE_SIZE}\" is only used in stripe mode")
+    
+    return config
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
+    cv.GenerateID(): cv.declare_id(FRAMVolumeComponent),
+    cv.Required(CONF_MEMBERS): cv.All(cv.ensure_list(cv.use_id(fram.FRAMComponent)), cv.Length(min=2,max=8)),
+    cv.Optional(CONF_MODE, default="concat"): cv.enum(VOLUME_MODES, lower=True),
+    cv.Optional(CONF_STRIPE_SIZE): cv.All(fram.validate_bytes_1024, cv.int_range(min=16,max=65536))
+}).extend(cv.COMPONENT_SCHEMA), validate_stripe)
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    
+    for member in config[CONF_MEMBERS]:
+        cg.add(var.addMember(await cg.get_variable(member)))
+    
+    cg.add(var.setMode(config[CONF_MODE], config.get(CONF_STRIPE_SIZE, 0)))
+    
+    # striped transfers run on all buses at once, one task per extra bus
+    if config[CONF_MODE] == "stripe" and CORE.is_esp32:
+        cg.add_define("USE_FRAM_VOLUME_PARALLEL")
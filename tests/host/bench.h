@@ -0,0 +1,64 @@
+#pragma once
+//  host benchmarks: one JSON object per line on stdout, to compare runs across commits.
+//
+//  {"bench":"seq_read","chunk":64,"ops":256,"transactions":..,"wire_bytes":..,"wire_us":..,"ns_per_op":..}
+//
+//  transactions and wire_bytes are counted on the fake bus, wire_us is the time on the
+//  wire from its clock cycles at 400kHz, ns_per_op is host time and only compares host runs.
+#include "fake_bus.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace esphome {
+namespace fram_test {
+
+const uint32_t BENCH_FREQUENCY = 400000;
+
+class Bench
+{
+public:
+  Bench(FakeBus * bus) : _bus(bus) { this->start(); }
+
+  //  "key":value pairs added to the report, in call order
+  Bench & param(const char * key, uint32_t value)
+  {
+    this->_params += ",\"" + std::string(key) + "\":" + std::to_string(value);
+    return *this;
+  }
+
+  void start()
+  {
+    this->_transactions = this->_bus->transactions;
+    this->_bytes = this->_bus->bytes;
+    this->_cycles = this->_bus->cycles;
+    this->_start = std::chrono::steady_clock::now();
+  }
+
+  //  bus clock cycles since start()
+  uint64_t cycles() { return this->_bus->cycles - this->_cycles; }
+  //  ops per second on the wire at BENCH_FREQUENCY
+  uint32_t perSecond(uint32_t ops) { return this->cycles() ? ops * (uint64_t) BENCH_FREQUENCY / this->cycles() : 0; }
+
+  void report(const char * name, uint32_t ops)
+  {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->_start).count();
+    printf("{\"bench\":\"%s\"%s,\"ops\":%u,\"transactions\":%zu,\"wire_bytes\":%zu,\"wire_us\":%llu,\"ns_per_op\":%llu}\n",
+      name, this->_params.c_str(), (unsigned)ops,
+      this->_bus->transactions - this->_transactions, this->_bus->bytes - this->_bytes,
+      (unsigned long long)((this->_bus->cycles - this->_cycles) * 1000000 / BENCH_FREQUENCY),
+      (unsigned long long)(ops ? ns / ops : ns));
+    this->_params.clear();
+  }
+
+protected:
+  FakeBus * _bus;
+  std::string _params;
+  size_t   _transactions{0};
+  size_t   _bytes{0};
+  uint64_t _cycles{0};
+  std::chrono::steady_clock::time_point _start;
+};
+
+}  // namespace fram_test
+}  // namespace esphome
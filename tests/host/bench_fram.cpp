@@ -0,0 +1,156 @@
+//  FRAM driver benchmarks: sequential read/write, typed loops, clear(), readLine()
+//  and the address layout
+#include "esphome/components/fram/FRAM.h"
+#include "bench.h"
+#include <random>
+
+using namespace esphome;
+using fram_test::Bench;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+static const uint32_t SIZE = 32768;
+static const uint32_t TOTAL = 16384;
+
+static void sequential(uint16_t maxTransfer)
+{
+  static uint8_t buf[4096];
+  for (uint32_t chunk : {1, 4, 16, 64, 256, 1024, 4096})
+  {
+    FakeBus bus(SIZE);
+    Device<fram::FRAM> fram(&bus, SIZE);
+    fram.setMaxTransfer(maxTransfer);
+    Bench bench(&bus);
+
+    for (uint32_t pos = 0; pos < TOTAL; pos += chunk) fram.write(pos, buf, chunk);
+    bench.param("chunk", chunk).param("max_transfer", maxTransfer).report("seq_write", TOTAL / chunk);
+
+    bench.start();
+    for (uint32_t pos = 0; pos < TOTAL; pos += chunk) fram.read(pos, buf, chunk);
+    bench.param("chunk", chunk).param("max_transfer", maxTransfer).report("seq_read", TOTAL / chunk);
+  }
+}
+
+static void typed()
+{
+  FakeBus bus(SIZE);
+  Device<fram::FRAM> fram(&bus, SIZE);
+  fram.setMaxTransfer(126);
+  const uint32_t ops = 4096;
+  uint32_t sum = 0;
+
+  Bench bench(&bus);
+  for (uint32_t i = 0; i < ops; i++) fram.write16(i * 2, i);
+  bench.report("write16", ops);
+  bench.start();
+  for (uint32_t i = 0; i < ops; i++) sum += fram.read16(i * 2);
+  bench.report("read16", ops);
+
+  bench.start();
+  for (uint32_t i = 0; i < ops; i++) fram.write32(i * 4, i);
+  bench.report("write32", ops);
+  bench.start();
+  for (uint32_t i = 0; i < ops; i++) sum += fram.read32(i * 4);
+  bench.report("read32", ops);
+
+  if (sum == 1) puts("");
+}
+
+static void clear()
+{
+  for (uint16_t maxTransfer : {24, 126, 1024})
+  {
+    FakeBus bus(SIZE);
+    Device<fram::FRAM> fram(&bus, SIZE);
+    fram.setMaxTransfer(maxTransfer);
+    Bench bench(&bus);
+    fram.clear();
+    bench.param("size", SIZE).param("max_transfer", maxTransfer).report("clear", 1);
+  }
+}
+
+static void lines()
+{
+  FakeBus bus(SIZE);
+  Device<fram::FRAM> fram(&bus, SIZE);
+  fram.setMaxTransfer(126);
+
+  //  lines of 10..80 bytes
+  std::mt19937 rnd(9);
+  uint32_t pos = 0;
+  uint32_t count = 0;
+  while (pos + 81 < TOTAL)
+  {
+    uint32_t len = 10 + rnd() % 71;
+    for (uint32_t k = 0; k < len - 1; k++) bus.mem[pos + k] = 'a' + rnd() % 26;
+    bus.mem[pos + len - 1] = '\n';
+    pos += len;
+    count++;
+  }
+
+  char line[128];
+  Bench bench(&bus);
+  for (uint32_t addr = 0, i = 0; i < count; i++) addr += fram.readLine(addr, line, sizeof(line));
+  bench.param("lines", count).report("readLine", count);
+
+  bench.start();
+  fram::FRAM_LINEREADER reader(&fram, 0, pos);
+  for (uint32_t i = 0; i < count; i++) reader.readLine(line, sizeof(line));
+  bench.param("lines", count).report("linereader", count);
+}
+
+//  the address layout is a per-instance constant, compare it with
+//  the same code on template arguments the compiler can fold
+template<class B> class Layout : public B
+{
+public:
+  uint8_t address(uint32_t memaddr, uint8_t & devaddr, uint8_t * maddr) { return this->_memoryAddress(memaddr, devaddr, maddr); }
+};
+
+template<uint8_t BYTES, uint8_t PAGE_MASK> static uint8_t constantAddress(uint32_t memaddr, uint8_t & devaddr, uint8_t * maddr)
+{
+  devaddr |= (memaddr >> (8 * BYTES)) & PAGE_MASK;
+  if (BYTES == 2) *maddr++ = (uint8_t)(memaddr >> 8);
+  *maddr = (uint8_t)(memaddr & 0xFF);
+  return BYTES;
+}
+
+template<class B, uint8_t BYTES, uint8_t PAGE_MASK> static void layout(const char * type)
+{
+  FakeBus bus(SIZE);
+  Layout<B> fram;
+  const uint32_t ops = 1 << 24;
+  volatile uint32_t sink = 0;
+  uint8_t maddr[2];
+
+  Bench bench(&bus);
+  for (uint32_t i = 0; i < ops; i++)
+  {
+    uint8_t devaddr = 0x50;
+    sink = sink + fram.address(i, devaddr, maddr) + devaddr + maddr[0];
+  }
+  bench.param("bytes", BYTES).param("page_mask", PAGE_MASK).report(type, ops);
+
+  bench.start();
+  for (uint32_t i = 0; i < ops; i++)
+  {
+    uint8_t devaddr = 0x50;
+    sink = sink + constantAddress<BYTES, PAGE_MASK>(i, devaddr, maddr) + devaddr + maddr[0];
+  }
+  bench.param("bytes", BYTES).param("page_mask", PAGE_MASK).report("address_constant", ops);
+}
+
+int main()
+{
+  sequential(24);
+  sequential(126);
+  sequential(1024);
+  typed();
+  clear();
+  lines();
+  layout<fram::FRAM, 2, 0x00>("address_FRAM");
+  layout<fram::FRAM32, 2, 0x01>("address_FRAM32");
+  layout<fram::FRAM11, 1, 0x07>("address_FRAM11");
+  layout<fram::FRAM9, 1, 0x01>("address_FRAM9");
+  return 0;
+}
@@ -0,0 +1,79 @@
+//  fram_pref boot: setup(), make_preference() and load() of every preference, then the first loop(),
+//  with and without the RAM shadow
+#include "esphome/components/fram_pref/FRAM_PREF.h"
+#include "bench.h"
+#include <array>
+#include <vector>
+
+using namespace esphome;
+using fram_test::Bench;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+class Prefs : public fram_pref::FRAM_PREF
+{
+public:
+  using FRAM_PREF::FRAM_PREF;
+  void run() { this->loop(); };
+};
+
+static const uint32_t SIZE = 32768;
+
+//  entities of 4..28 bytes, as switches, numbers and climate states
+static const uint8_t SIZES[] = {4, 8, 16, 28};
+
+template<size_t N> static void access(ESPPreferenceObject & obj, bool save, uint8_t value)
+{
+  std::array<uint8_t, N> data;
+  data.fill(value);
+  if (save) obj.save(&data);
+  else obj.load(&data);
+}
+
+static void access(ESPPreferenceObject & obj, uint8_t size, bool save, uint8_t value = 0)
+{
+  switch (size)
+  {
+    case 4: access<4>(obj, save, value); break;
+    case 8: access<8>(obj, save, value); break;
+    case 16: access<16>(obj, save, value); break;
+    default: access<28>(obj, save, value); break;
+  }
+}
+
+static void boot(FakeBus & bus, uint32_t count, bool shadow, bool save, Bench * bench)
+{
+  Device<fram::FRAM> fram(&bus, SIZE);
+  fram.setMaxTransfer(126);
+  Prefs prefs(&fram);
+  prefs.set_pool(30000, 0);
+  prefs.set_shadow(shadow, false);
+  if (bench) bench->start();
+
+  prefs.setup();
+  std::vector<ESPPreferenceObject> objs;
+  for (uint32_t i = 0; i < count; i++) objs.push_back(prefs.make_preference(SIZES[i % 4], 1000 + i));
+  for (uint32_t i = 0; i < count; i++) access(objs[i], SIZES[i % 4], false);
+  prefs.run();
+
+  if (bench) bench->param("prefs", count).param("shadow", shadow).report("pref_boot", count);
+  if (!save) return;
+  for (uint32_t i = 0; i < count; i++) access(objs[i], SIZES[i % 4], true, i);
+}
+
+int main()
+{
+  for (uint32_t count : {10, 100, 200, 500})
+  {
+    //  the difference the RAM shadow makes, against a load() per preference
+    for (bool shadow : {false, true})
+    {
+      FakeBus bus(SIZE);
+      //  first boot creates the records, the second one loads them
+      boot(bus, count, shadow, true, nullptr);
+      Bench bench(&bus);
+      boot(bus, count, shadow, false, &bench);
+    }
+  }
+  return 0;
+}
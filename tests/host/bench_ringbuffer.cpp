@@ -0,0 +1,116 @@
+//  fram_ringbuffer records per second at 400kHz, fixed and variable records,
+//  one at a time and in batches, with and without saving the pointers every loop()
+#include "esphome/components/fram_ringbuffer/FRAM_RINGBUFFER.h"
+#include "bench.h"
+#include <random>
+#include <vector>
+
+using namespace esphome;
+using fram_test::Bench;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+static const uint32_t SIZE = 32768;
+static const uint32_t RECORDS = 200;
+static const uint32_t BATCH = 10;
+
+//  records as packed by pushMany(), variable ones with their uint16_t length
+static std::vector<uint8_t> records(uint16_t recordSize, uint32_t count)
+{
+  std::mt19937 rnd(count);
+  std::vector<uint8_t> buf;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint16_t len = recordSize ? recordSize : 8 + rnd() % 49;
+    if (!recordSize)
+    {
+      buf.push_back(len & 0xFF);
+      buf.push_back(len >> 8);
+    }
+    for (uint16_t k = 0; k < len; k++) buf.push_back(rnd());
+  }
+  return buf;
+}
+
+static void run(uint16_t recordSize, uint32_t batch, bool saveEveryLoop)
+{
+  FakeBus bus(SIZE);
+  Device<fram::FRAM> fram(&bus, SIZE);
+  fram.setMaxTransfer(126);
+  fram_ringbuffer::FRAM_RINGBUFFER rb(&fram);
+  rb.setRegion(0, SIZE);
+  rb.setRecordSize(recordSize);
+  rb.setSaveInterval(saveEveryLoop ? 0 : 3600000);
+  rb.setup();
+
+  std::vector<uint8_t> data = records(recordSize, RECORDS);
+  std::vector<uint8_t> out(data.size());
+
+  Bench bench(&bus);
+  if (batch == 1)
+  {
+    for (size_t pos = 0; pos < data.size();)
+    {
+      uint16_t len = recordSize ? recordSize : data[pos] | (data[pos + 1] << 8);
+      if (!recordSize) pos += 2;
+      rb.push(&data[pos], len);
+      pos += len;
+      rb.loop();
+    }
+  }
+  else
+  {
+    size_t pos = 0;
+    for (uint32_t i = 0; i < RECORDS; i += batch)
+    {
+      size_t start = pos;
+      for (uint32_t k = 0; k < batch; k++)
+        pos += recordSize ? recordSize : 2 + (data[pos] | (data[pos + 1] << 8));
+      rb.pushMany(&data[start], batch);
+      rb.loop();
+    }
+  }
+  bench.param("record_size", recordSize).param("batch", batch).param("save_every_loop", saveEveryLoop)
+    .param("records_per_s", bench.perSecond(RECORDS)).report("ringbuffer_push", RECORDS);
+
+  bench.start();
+  uint32_t popped = 0;
+  if (batch == 1)
+  {
+    for (size_t pos = 0; popped < RECORDS; popped++)
+    {
+      int32_t len = rb.pop(&out[pos], out.size() - pos);
+      if (len < 0) break;
+      pos += len;
+      rb.loop();
+    }
+  }
+  else
+  {
+    //  room for batch records of the largest size
+    uint32_t room = batch * (recordSize ? recordSize : 2 + 56);
+    std::vector<uint8_t> part(room);
+    while (popped < RECORDS)
+    {
+      uint32_t n = rb.popMany(part.data(), room);
+      if (!n) break;
+      popped += n;
+      rb.loop();
+    }
+  }
+  bench.param("record_size", recordSize).param("batch", batch).param("save_every_loop", saveEveryLoop)
+    .param("records_per_s", bench.perSecond(popped)).report("ringbuffer_pop", popped);
+}
+
+int main()
+{
+  for (uint16_t recordSize : {16, 64, 0})
+  {
+    for (uint32_t batch : {1u, BATCH})
+    {
+      run(recordSize, batch, false);
+      run(recordSize, batch, true);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+//  simulated I2C FRAM on a bus, for host tests
+//
+//  device addresses base..base+7 select the page bits above the memory address
+//  bytes, like FRAM9/FRAM11/FRAM32. the address pointer wraps inside a page.
+#include "esphome/components/i2c/i2c.h"
+#include <cstdio>
+#include <vector>
+
+namespace esphome {
+namespace fram_test {
+
+class FakeBus : public i2c::I2CBus
+{
+public:
+  FakeBus(size_t size, uint8_t addrBytes = 2, uint8_t pageBits = 16, uint8_t base = 0x50)
+    : mem(size, 0xEE), _addrBytes(addrBytes), _pageBits(pageBits), _base(base) {}
+
+  i2c::ErrorCode readv(uint8_t address, i2c::ReadBuffer * buffers, size_t cnt) override
+  {
+    if (address < this->_base || address > this->_base + 7) return i2c::ERROR_NOT_ACKNOWLEDGED;
+    this->transactions++;
+
+    size_t len = 0;
+    for (size_t i = 0; i < cnt; i++) len += buffers[i].len;
+    this->_clock(len, true);
+
+    this->_pointer = (this->_pointer & this->_pageMask()) | this->_page(address);
+    bool first = true;
+    for (size_t i = 0; i < cnt; i++)
+    {
+      if (buffers[i].len > this->maxTransfer) return i2c::ERROR_TOO_LARGE;
+      this->bytes += buffers[i].len;
+      for (size_t j = 0; j < buffers[i].len; j++)
+      {
+        this->_wrapped(first);
+        buffers[i].data[j] = this->mem[this->_pointer % this->mem.size()];
+        this->_next();
+      }
+    }
+    return i2c::ERROR_OK;
+  }
+
+  i2c::ErrorCode writev(uint8_t address, i2c::WriteBuffer * buffers, size_t cnt, bool stop) override
+  {
+    if (address < this->_base || address > this->_base + 7) return i2c::ERROR_NOT_ACKNOWLEDGED;
+    //  power cut: the device no longer takes writes, but the master sees no error
+    if (this->writesLeft == 0) return i2c::ERROR_OK;
+    if (this->writesLeft > 0) this->writesLeft--;
+    this->transactions++;
+
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < cnt; i++) data.insert(data.end(), buffers[i].data, buffers[i].data + buffers[i].len);
+    if (data.size() > this->maxTransfer) return i2c::ERROR_TOO_LARGE;
+    this->bytes += data.size();
+    this->_clock(data.size(), stop);
+    if (data.size() < this->_addrBytes) return i2c::ERROR_OK;
+    this->addressPhases++;
+
+    uint32_t memaddr = 0;
+    for (uint8_t i = 0; i < this->_addrBytes; i++) memaddr = (memaddr << 8) | data[i];
+    this->_pointer = this->_page(address) | (memaddr & this->_pageMask());
+    bool first = true;
+    for (size_t j = this->_addrBytes; j < data.size(); j++)
+    {
+      this->_wrapped(first);
+      this->mem[this->_pointer % this->mem.size()] = data[j];
+      this->_next();
+    }
+    return i2c::ERROR_OK;
+  }
+
+  std::vector<uint8_t> mem;
+  //  bus calls, a read is two: the memory address and the data.
+  //  bytes after the device address, memory address included
+  size_t   transactions{0};
+  size_t   bytes{0};
+  //  writes of a memory address, each read and write has one
+  size_t   addressPhases{0};
+  //  bus clock cycles: start or repeated start, 9 per byte with ACK, stop
+  uint64_t cycles{0};
+  //  transfers that went on past the end of a page, the device wraps to its start
+  size_t   pageWraps{0};
+  //  larger transfers fail, like a small bus buffer
+  size_t   maxTransfer{1 << 20};
+  //  write transactions until a power cut, -1 never
+  int32_t  writesLeft{-1};
+
+protected:
+  void     _clock(size_t len, bool stop)
+  {
+    this->cycles += 1 + (1 + len) * 9 + (stop ? 1 : 0);
+  }
+  void     _wrapped(bool & first)
+  {
+    if (!first && !(this->_pointer & this->_pageMask())) this->pageWraps++;
+    first = false;
+  }
+  uint32_t _page(uint8_t address) { return (uint32_t)(address - this->_base) << this->_pageBits; }
+  uint32_t _pageMask() { return (1UL << this->_pageBits) - 1; }
+  void     _next()
+  {
+    this->_pointer = (this->_pointer & ~this->_pageMask()) | ((this->_pointer + 1) & this->_pageMask());
+  }
+
+  uint8_t  _addrBytes;
+  uint8_t  _pageBits;
+  uint8_t  _base;
+  uint32_t _pointer{0};
+};
+
+//  gives tests the bus and address an esphome config would set
+template<class B> class Device : public B
+{
+public:
+  Device(i2c::I2CBus * bus, uint32_t size, uint8_t address = 0x50)
+  {
+    this->set_i2c_bus(bus);
+    this->set_i2c_address(address);
+    this->setSizeBytes(size);
+  }
+};
+
+}  // namespace fram_test
+}  // namespace esphome
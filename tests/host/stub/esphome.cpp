@@ -0,0 +1,56 @@
+//  runtime of the stub esphome headers
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+#include <chrono>
+#include <cstdarg>
+
+static const auto START = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count();
+}
+uint32_t millis() { return micros() / 1000; }
+void delayMicroseconds(uint32_t us) {}
+void delay(uint32_t ms) {}
+void yield() {}
+
+namespace esphome {
+
+namespace setup_priority {
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float AFTER_WIFI = 200.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+float Component::get_setup_priority() const { return setup_priority::DATA; }
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+std::string str_sprintf(const char *fmt, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return buf;
+}
+
+uint32_t Application::get_loop_component_start_time() const { return millis(); }
+
+Application App;
+ESPPreferences *global_preferences = nullptr;
+
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace i2c {
+
+enum ErrorCode {
+  NO_ERROR = 0,
+  ERROR_OK = 0,
+  ERROR_INVALID_ARGUMENT = 1,
+  ERROR_NOT_ACKNOWLEDGED = 2,
+  ERROR_TIMEOUT = 3,
+  ERROR_NOT_INITIALIZED = 4,
+  ERROR_TOO_LARGE = 5,
+  ERROR_UNKNOWN = 6,
+  ERROR_CRC = 7,
+};
+
+struct ReadBuffer {
+  uint8_t *data;
+  size_t len;
+};
+
+struct WriteBuffer {
+  const uint8_t *data;
+  size_t len;
+};
+
+class I2CBus {
+ public:
+  virtual ErrorCode read(uint8_t address, uint8_t *buffer, size_t len) {
+    ReadBuffer buf{buffer, len};
+    return this->readv(address, &buf, 1);
+  }
+  virtual ErrorCode readv(uint8_t address, ReadBuffer *buffers, size_t cnt) = 0;
+  virtual ErrorCode write(uint8_t address, const uint8_t *buffer, size_t len) {
+    return this->write(address, buffer, len, true);
+  }
+  virtual ErrorCode write(uint8_t address, const uint8_t *buffer, size_t len, bool stop) {
+    WriteBuffer buf{buffer, len};
+    return this->writev(address, &buf, 1, stop);
+  }
+  virtual ErrorCode writev(uint8_t address, WriteBuffer *buffers, size_t cnt) {
+    return this->writev(address, buffers, cnt, true);
+  }
+  virtual ErrorCode writev(uint8_t address, WriteBuffer *buffers, size_t cnt, bool stop) = 0;
+};
+
+class I2CDevice {
+ public:
+  void set_i2c_address(uint8_t address) { this->address_ = address; }
+  uint8_t get_i2c_address() const { return this->address_; }
+  void set_i2c_bus(I2CBus *bus) { this->bus_ = bus; }
+
+ protected:
+  uint8_t address_{0};
+  I2CBus *bus_{nullptr};
+};
+
+}  // namespace i2c
+}  // namespace esphome
@@ -0,0 +1,34 @@
+#pragma once
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    for (auto &cb : this->callbacks_)
+      cb(state);
+  }
+  float get_state() const { return this->state; }
+  const char *get_name() const { return "sensor"; }
+  void add_on_state_callback(std::function<void(float)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+
+  float state{NAN};
+
+ protected:
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG("", "%s%s '%s'", prefix, type, (obj)->get_name()); \
+  }
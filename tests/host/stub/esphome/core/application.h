@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+class Application {
+ public:
+  const std::string &get_compilation_time() const { return this->compilation_time_; }
+  //  counts feeds from other threads than the one that started the program
+  void feed_wdt() {
+    this->wdt_feeds++;
+    if (std::this_thread::get_id() != this->loop_thread_)
+      this->wdt_feeds_off_loop++;
+  }
+  uint32_t get_loop_component_start_time() const;
+
+  //  tests change it to simulate a new firmware
+  std::string compilation_time_{"Jan  1 2026, 00:00:00"};
+  std::atomic<uint32_t> wdt_feeds{0};
+  std::atomic<uint32_t> wdt_feeds_off_loop{0};
+
+ protected:
+  std::thread::id loop_thread_{std::this_thread::get_id()};
+};
+
+extern Application App;
+
+}  // namespace esphome
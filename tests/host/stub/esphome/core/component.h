@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+namespace setup_priority {
+extern const float BUS;
+extern const float IO;
+extern const float HARDWARE;
+extern const float DATA;
+extern const float PROCESSOR;
+extern const float AFTER_WIFI;
+extern const float LATE;
+}  // namespace setup_priority
+
+//  no scheduler, timeouts and intervals are dropped, defer() runs at once
+class Component {
+ public:
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const;
+  virtual void on_shutdown() {}
+  virtual void on_safe_shutdown() {}
+  void mark_failed() { this->failed_ = true; }
+  bool is_failed() const { return this->failed_; }
+  bool is_ready() const { return !this->failed_; }
+  void disable_loop() {}
+  void enable_loop() {}
+  void status_set_warning(const char *message = "unspecified") {}
+  void status_clear_warning() {}
+
+ protected:
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {}
+  void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {}
+  void defer(std::function<void()> &&f) { f(); }
+  void cancel_timeout(const std::string &name) {}
+
+  bool failed_{false};
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() {}
+  PollingComponent(uint32_t update_interval) {}
+  virtual void update() = 0;
+  void set_update_interval(uint32_t update_interval) {}
+};
+
+}  // namespace esphome
@@ -0,0 +1,2 @@
+#pragma once
+//  features are enabled per test target, with USE_FRAM_* compile definitions
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+uint32_t micros();
+uint32_t millis();
+void delayMicroseconds(uint32_t us);
+void delay(uint32_t ms);
+void yield();
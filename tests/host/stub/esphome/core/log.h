@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdio>
+//  to stderr, benchmarks keep stdout for their JSON lines
+
+#define ESP_LOGE(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGW(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGI(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGD(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGV(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGCONFIG(tag, ...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
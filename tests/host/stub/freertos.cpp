@@ -0,0 +1,87 @@
+//  FreeRTOS queues and tasks on std::thread, for USE_FRAM_ASYNC on the host
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct QueueDefinition {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length;
+  size_t item_size;
+};
+
+struct TaskDefinition {
+  TaskFunction_t function;
+  void *arg;
+};
+
+//  the main thread is the loop task
+static TaskDefinition loop_task{nullptr, nullptr};
+static thread_local TaskHandle_t current_task = &loop_task;
+
+static bool wait_for(QueueHandle_t queue, std::unique_lock<std::mutex> &lock, TickType_t wait, bool (*ready)(QueueHandle_t)) {
+  if (ready(queue))
+    return true;
+  if (wait == 0)
+    return false;
+  if (wait == portMAX_DELAY) {
+    queue->changed.wait(lock, [queue, ready] { return ready(queue); });
+    return true;
+  }
+  return queue->changed.wait_for(lock, std::chrono::milliseconds(wait), [queue, ready] { return ready(queue); });
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto *queue = new QueueDefinition;
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(queue, lock, wait, [](QueueHandle_t q) { return q->items.size() < q->length; }))
+    return pdFALSE;
+  const uint8_t *data = static_cast<const uint8_t *>(item);
+  queue->items.emplace_back(data, data + queue->item_size);
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!wait_for(queue, lock, wait, [](QueueHandle_t q) { return !q->items.empty(); }))
+    return pdFALSE;
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->lock);
+  return queue->items.size();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  auto *task = new TaskDefinition{function, arg};
+  if (handle != nullptr)
+    *handle = task;
+  std::thread([task] {
+    current_task = task;
+    task->function(task->arg);
+  }).detach();
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return current_task; }
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
@@ -0,0 +1,12 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct TaskDefinition;
+typedef TaskDefinition * TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+//  tasks are detached threads, priority and core are ignored
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stack, void * arg,
+                                   UBaseType_t priority, TaskHandle_t * handle, BaseType_t core);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,12 @@
+#pragma once
+//  checks stay on in release builds, a failure ends the test program
+#include <cstdio>
+#include <cstdlib>
+
+#define TEST_CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      exit(1); \
+    } \
+  } while (0)
@@ -0,0 +1,111 @@
+//  async requests: completion order, read-after-write through the worker task,
+//  submits from several tasks, and no watchdog feeds off the loop task
+#include "esphome/components/fram/FRAM.h"
+#include "esphome/core/application.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+//  the worker task and the submitting threads share the bus
+class LockedBus : public FakeBus
+{
+public:
+  using FakeBus::FakeBus;
+  i2c::ErrorCode readv(uint8_t address, i2c::ReadBuffer * buffers, size_t cnt) override
+  {
+    std::lock_guard<std::mutex> guard(this->_lock);
+    return FakeBus::readv(address, buffers, cnt);
+  }
+  i2c::ErrorCode writev(uint8_t address, i2c::WriteBuffer * buffers, size_t cnt, bool stop) override
+  {
+    std::lock_guard<std::mutex> guard(this->_lock);
+    return FakeBus::writev(address, buffers, cnt, stop);
+  }
+
+protected:
+  std::mutex _lock;
+};
+
+static void drain(fram::FRAM & fram, std::function<bool()> done)
+{
+  for (int i = 0; i < 100000 && !done(); i++)
+  {
+    fram.loop();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  TEST_CHECK(done());
+}
+
+int main()
+{
+  LockedBus bus(32768);
+  Device<fram::FRAM> fram(&bus, 32768);
+  fram.setMaxTransfer(126);
+  fram.setWriteBuffer(256);
+  fram.setAsync(4, 5, -1);
+  fram.setup();
+  const std::thread::id loop = std::this_thread::get_id();
+
+  //  write then read back the same range, every callback in submit order, on the loop task
+  static uint8_t written[64][40];
+  static uint8_t read[64][40];
+  std::vector<int> order;
+  bool offLoop = false;
+  for (int i = 0; i < 64; i++)
+  {
+    memset(written[i], i + 1, sizeof(written[i]));
+    auto note = [&, i](int id) { order.push_back(id); offLoop |= std::this_thread::get_id() != loop; };
+    while (!fram.writeAsync(1000 + (i % 4) * 8, written[i], sizeof(written[i]), [note, i]() { note(2 * i); })) fram.loop();
+    while (!fram.readAsync(1000 + (i % 4) * 8, read[i], sizeof(read[i]), [note, i]() { note(2 * i + 1); })) fram.loop();
+  }
+  drain(fram, [&]() { return order.size() == 128; });
+  TEST_CHECK(!offLoop);
+  for (int i = 0; i < 128; i++) TEST_CHECK(order[i] == i);
+  for (int i = 0; i < 64; i++) TEST_CHECK(memcmp(read[i], written[i], sizeof(read[i])) == 0);
+
+  //  submits from several tasks, each to its own range, also filled by the worker
+  std::atomic<int> completed{0};
+  static uint8_t values[4][16][100];
+  std::vector<std::thread> tasks;
+  for (int t = 0; t < 4; t++)
+  {
+    tasks.emplace_back([&, t]() {
+      for (int k = 0; k < 16; k++)
+      {
+        memset(values[t][k], t * 16 + k, 100);
+        while (!fram.writeAsync(4000 + t * 1000, values[t][k], 100, [&]() { completed++; })) std::this_thread::yield();
+      }
+      while (!fram.fillAsync(4000 + t * 1000 + 100, 900, 0xA0 + t, [&]() { completed++; })) std::this_thread::yield();
+    });
+  }
+  drain(fram, [&]() { return completed == 4 * 17; });
+  for (auto & task : tasks) task.join();
+
+  uint8_t buf[1000];
+  for (int t = 0; t < 4; t++)
+  {
+    fram.read(4000 + t * 1000, buf, 1000);
+    for (int k = 0; k < 100; k++) TEST_CHECK(buf[k] == t * 16 + 15);
+    for (int k = 100; k < 1000; k++) TEST_CHECK(buf[k] == 0xA0 + t);
+  }
+
+  //  a long fill on the worker task, then one on the loop task
+  uint32_t feeds = App.wdt_feeds;
+  bool filled = false;
+  TEST_CHECK(fram.fillAsync(10000, 20000, 0x55, [&]() { filled = true; }));
+  drain(fram, [&]() { return filled; });
+  TEST_CHECK(App.wdt_feeds == feeds);
+  fram.fill(10000, 20000, 0x66);
+  printf("watchdog feeds: %u on the loop task, %u off it\n", (unsigned)(App.wdt_feeds - feeds), (unsigned)App.wdt_feeds_off_loop);
+  TEST_CHECK(App.wdt_feeds > feeds);
+  TEST_CHECK(App.wdt_feeds_off_loop == 0);
+
+  puts("ok");
+  return 0;
+}
@@ -0,0 +1,89 @@
+//  writeCompressed() stays in its footprint, and cut off after any write
+//  transaction keeps the old or the new blob
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <random>
+#include <string>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+//  bytes after the returned footprint keep a sentinel, for data that does and does not compress
+static void footprint(uint32_t seed)
+{
+  std::mt19937 rnd(seed);
+  const uint32_t memaddr = 100;
+
+  for (uint32_t size = 1; size < 300; size++)
+  {
+    std::vector<uint8_t> data(size);
+    uint32_t alphabet = 1 + rnd() % 256;
+    for (auto & c : data) c = rnd() % alphabet;
+
+    FakeBus bus(4096);
+    memset(bus.mem.data(), 0x5A, bus.mem.size());
+    Device<fram::FRAM> fram(&bus, 4096);
+    fram.setMaxTransfer(126);
+    if (seed & 1) fram.setWriteBuffer(256);
+
+    uint32_t used = fram.writeCompressed(memaddr, data.data(), size);
+    fram.flush();
+    TEST_CHECK(used <= sizeof(fram::FRAM_BLOB) + size);
+    for (uint32_t i = 0; i < bus.mem.size(); i++)
+    {
+      if (i >= memaddr && i < memaddr + used) continue;
+      if (bus.mem[i] != 0x5A) fprintf(stderr, "size %u, alphabet %u: byte %u of %u used changed\n",
+        (unsigned)size, (unsigned)alphabet, (unsigned)(i - memaddr), (unsigned)used);
+      TEST_CHECK(bus.mem[i] == 0x5A);
+    }
+
+    std::vector<uint8_t> back(size);
+    TEST_CHECK(fram.readCompressed(memaddr, back.data(), size) == (int32_t)size);
+    TEST_CHECK(back == data);
+  }
+}
+
+int main()
+{
+  footprint(0);
+  footprint(1);
+
+  std::string older(600, 'a');
+  std::string newer;
+  for (int i = 0; i < 600; i++) newer += "{\"k\":" + std::to_string(i % 37) + "}";
+  newer.resize(600);
+
+  for (int buffer = 0; buffer < 2; buffer++)
+  {
+    for (int32_t cut = 0; cut < 60; cut++)
+    {
+      FakeBus bus(32768);
+      Device<fram::FRAM> fram(&bus, 32768);
+      fram.setMaxTransfer(126);
+      if (buffer) fram.setWriteBuffer(256);
+
+      fram.writeCompressed(100, (const uint8_t *)older.data(), older.size());
+      fram.flush();
+      bus.writesLeft = cut;
+      fram.writeCompressed(100, (const uint8_t *)newer.data(), newer.size());
+      fram.flush();
+
+      //  after the power cut
+      bus.writesLeft = -1;
+      Device<fram::FRAM> boot(&bus, 32768);
+      boot.setMaxTransfer(126);
+      uint8_t buf[700];
+      int32_t len = boot.readCompressed(100, buf, sizeof(buf));
+
+      bool ok = len == -1 || (len == 600 &&
+        (memcmp(buf, newer.data(), 600) == 0 || memcmp(buf, older.data(), 600) == 0));
+      if (!ok) fprintf(stderr, "write buffer %d, cut after %d writes: %d\n", buffer, (int)cut, (int)len);
+      TEST_CHECK(ok);
+    }
+  }
+
+  puts("ok");
+  return 0;
+}
@@ -0,0 +1,90 @@
+//  fram_kv against a map model, with compaction in loop() and reloads
+#include "esphome/components/fram_kv/FRAM_KV.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+int main()
+{
+  FakeBus bus(262144);
+  Device<fram::FRAM32> fram(&bus, 262144);
+  std::map<std::string, std::vector<uint8_t>> model;
+  std::mt19937 rnd(15);
+
+  auto boot = [&]() {
+    auto kv = std::unique_ptr<fram_kv::FRAM_KV>(new fram_kv::FRAM_KV(&fram));
+    //  across the 64KiB page of FRAM32
+    kv->setRegion(60000, 8000);
+    kv->setMaxKeys(200);
+    kv->setup();
+    return kv;
+  };
+
+  auto kv = boot();
+  uint32_t fails = 0;
+  uint32_t reloads = 0;
+  uint8_t buf[400];
+
+  for (int i = 0; i < 50000; i++)
+  {
+    uint32_t op = rnd() % 20;
+    std::string key = "k" + std::to_string(rnd() % 250);
+
+    if (op < 8)
+    {
+      std::vector<uint8_t> value(rnd() % ((rnd() % 10) ? 20 : 300));
+      for (auto & c : value) c = rnd();
+      if (kv->put(key, value.data(), value.size())) model[key] = value;
+      else fails++;
+    }
+    else if (op < 14)
+    {
+      int32_t len = kv->get(key, buf, sizeof(buf));
+      auto it = model.find(key);
+      if (it == model.end())
+      {
+        TEST_CHECK(len == -1);
+      }
+      else
+      {
+        TEST_CHECK(len == (int32_t)it->second.size());
+        TEST_CHECK(memcmp(buf, it->second.data(), len) == 0);
+      }
+    }
+    else if (op < 16)
+    {
+      TEST_CHECK(kv->erase(key) == (model.erase(key) > 0));
+    }
+    else if (op < 19)
+    {
+      kv->loop();
+    }
+    else if (rnd() % 50 == 0)
+    {
+      kv = boot();
+      reloads++;
+    }
+
+    TEST_CHECK(kv->count() == model.size());
+  }
+
+  printf("%u keys, %u bytes free, %u dead, %u full puts, %u reloads\n",
+    kv->count(), kv->free(), kv->getDeadBytes(), fails, reloads);
+
+  kv = boot();
+  for (auto & entry : model)
+  {
+    TEST_CHECK(kv->get(entry.first, buf, sizeof(buf)) == (int32_t)entry.second.size());
+    TEST_CHECK(memcmp(buf, entry.second.data(), entry.second.size()) == 0);
+  }
+
+  puts("ok");
+  return 0;
+}
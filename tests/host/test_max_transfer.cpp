@@ -0,0 +1,46 @@
+//  bus transactions per KiB: the old fixed 24 byte blocks against larger max_transfer
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+int main()
+{
+  static uint8_t buf[1024];
+  size_t writes24 = 0;
+
+  for (uint16_t maxTransfer : {24, 126, 1024})
+  {
+    FakeBus bus(32768);
+    Device<fram::FRAM> fram(&bus, 32768);
+    fram.setMaxTransfer(maxTransfer);
+    uint32_t blocks = (1024 + maxTransfer - 1) / maxTransfer;
+
+    for (uint32_t i = 0; i < 1024; i++) buf[i] = i * 7;
+    fram.write(0, buf, 1024);
+    size_t writes = bus.transactions;
+    size_t writePhases = bus.addressPhases;
+
+    bus.transactions = bus.addressPhases = 0;
+    memset(buf, 0, sizeof(buf));
+    fram.read(0, buf, 1024);
+    for (uint32_t i = 0; i < 1024; i++) TEST_CHECK(buf[i] == (uint8_t)(i * 7));
+
+    printf("1KiB at max_transfer %4u: write %3zu transactions, %3zu address phases, "
+      "read %3zu transactions, %3zu address phases\n",
+      maxTransfer, writes, writePhases, bus.transactions, bus.addressPhases);
+
+    //  one address phase per block, a read also sends the address
+    TEST_CHECK(writes == blocks && writePhases == blocks);
+    TEST_CHECK(bus.transactions == 2 * blocks && bus.addressPhases == blocks);
+
+    if (maxTransfer == 24) writes24 = writes;
+    else TEST_CHECK(writes < writes24);
+  }
+
+  puts("ok");
+  return 0;
+}
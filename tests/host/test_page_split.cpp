@@ -0,0 +1,85 @@
+//  transfer planner: random ranges on all addressing types against a flat memory model,
+//  no transaction may run past a page, the high address bits are in the device address
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+template<class B> static void run(uint32_t size, uint8_t addrBytes, uint8_t pageBits, uint32_t mode, uint32_t seed)
+{
+  FakeBus bus(size, addrBytes, pageBits);
+  Device<B> fram(&bus, size);
+  if (mode & 1) fram.setReadCache(16, 8);
+  if (mode & 2) fram.setWriteBuffer(128);
+
+  std::vector<uint8_t> model(bus.mem);
+  std::mt19937 rnd(seed);
+  static uint8_t buf[1200];
+
+  for (int i = 0; i < 1000; i++)
+  {
+    fram.setMaxTransfer(1 + rnd() % 300);
+    uint32_t len = 1 + rnd() % std::min<uint32_t>(size, sizeof(buf));
+    uint32_t addr = rnd() % (size - len + 1);
+    uint32_t op = rnd() % 10;
+
+    if (op < 4)
+    {
+      for (uint32_t k = 0; k < len; k++) model[addr + k] = buf[k] = rnd();
+      fram.write(addr, buf, len);
+    }
+    else if (op < 8)
+    {
+      fram.read(addr, buf, len);
+      TEST_CHECK(memcmp(buf, &model[addr], len) == 0);
+    }
+    else if (op == 8)
+    {
+      uint8_t value = rnd();
+      fram.fill(addr, len, value);
+      memset(&model[addr], value, len);
+    }
+    else
+    {
+      fram.flush();
+    }
+    TEST_CHECK(bus.pageWraps == 0);
+  }
+
+  fram.flush();
+  TEST_CHECK(bus.mem == model);
+  TEST_CHECK(bus.pageWraps == 0);
+}
+
+int main()
+{
+  for (uint32_t seed = 0; seed < 8; seed++)
+  {
+    for (uint32_t mode = 0; mode < 4; mode++)
+    {
+      run<fram::FRAM9>(512, 1, 8, mode, seed);
+      run<fram::FRAM11>(2048, 1, 8, mode, seed);
+      run<fram::FRAM>(32768, 2, 16, mode, seed);
+      run<fram::FRAM32>(131072, 2, 16, mode, seed);
+    }
+  }
+
+  //  the longest transfers: one per page at most
+  FakeBus bus(2048, 1, 8);
+  Device<fram::FRAM11> fram(&bus, 2048);
+  fram.setMaxTransfer(1024);
+  static uint8_t buf[2048];
+  fram.write(0, buf, 2048);
+  printf("FRAM11 2KiB write at max_transfer 1024: %zu transactions\n", bus.transactions);
+  TEST_CHECK(bus.transactions == 8);
+  bus.transactions = 0;
+  fram.write(200, buf, 100);
+  TEST_CHECK(bus.transactions == 2);
+
+  puts("ok");
+  return 0;
+}
@@ -0,0 +1,87 @@
+//  fram_pref: saves with and without the kept shadow read back after a reboot
+#include "esphome/components/fram_pref/FRAM_PREF.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <array>
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+class Prefs : public fram_pref::FRAM_PREF
+{
+public:
+  using FRAM_PREF::FRAM_PREF;
+  void run() { this->loop(); };
+  auto & prefs() { return this->prefs_; };
+};
+
+static uint32_t type(uint32_t i) { return i == 0 ? 77 : 100 + i; }
+
+int main()
+{
+  for (int keep = 0; keep < 2; keep++)
+  {
+    FakeBus bus(32768);
+    std::vector<std::array<uint8_t, 200>> values(20);
+
+    {
+      Device<fram::FRAM> fram(&bus, 32768);
+      fram.setMaxTransfer(1 + keep * 40);
+      Prefs prefs(&fram);
+      prefs.set_pool(4096, 100);
+      prefs.set_shadow(true, keep);
+      prefs.set_static_pref("s", 5000, 202, []() { return 77u; }, false);
+      prefs.setup();
+      prefs.run();
+
+      std::vector<ESPPreferenceObject> objs;
+      for (uint32_t i = 0; i < 20; i++) objs.push_back(prefs.make_preference(200, type(i)));
+
+      std::mt19937 rnd(keep);
+      size_t start = bus.transactions;
+      for (int it = 0; it < 5000; it++)
+      {
+        uint32_t i = rnd() % 20;
+        auto & value = values[i];
+        uint32_t changes = rnd() % 4;
+        for (uint32_t k = 0; k < changes; k++) value[rnd() % 200] = rnd();
+        TEST_CHECK(objs[i].save(&value));
+
+        if (rnd() % 10 == 0)
+        {
+          std::array<uint8_t, 200> loaded;
+          TEST_CHECK(objs[i].load(&loaded));
+          TEST_CHECK(loaded == value);
+        }
+      }
+
+      uint32_t saves = 0, skipped = 0, partial = 0;
+      for (auto & pref : prefs.prefs())
+      {
+        saves += pref.saves;
+        skipped += pref.saves_skipped;
+        partial += pref.saves_partial;
+      }
+      printf("keep shadow %d: %u saves, %u skipped, %u partial, %zu transactions\n",
+        keep, saves, skipped, partial, bus.transactions - start);
+    }
+
+    Device<fram::FRAM> fram(&bus, 32768);
+    Prefs prefs(&fram);
+    prefs.set_pool(4096, 100);
+    prefs.set_static_pref("s", 5000, 202, []() { return 77u; }, false);
+    prefs.setup();
+    for (uint32_t i = 0; i < 20; i++)
+    {
+      auto obj = prefs.make_preference(200, type(i));
+      std::array<uint8_t, 200> loaded;
+      TEST_CHECK(obj.load(&loaded));
+      TEST_CHECK(loaded == values[i]);
+    }
+  }
+
+  puts("ok");
+  return 0;
+}
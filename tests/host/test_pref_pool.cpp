@@ -0,0 +1,64 @@
+//  fram_pref pool full at boot: new records wait for loop(), live ones are kept
+#include "esphome/components/fram_pref/FRAM_PREF.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <algorithm>
+#include <array>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+class Prefs : public fram_pref::FRAM_PREF
+{
+public:
+  using FRAM_PREF::FRAM_PREF;
+  void run() { this->loop(); };
+};
+
+static FakeBus bus(32768);
+
+//  types are requested in order, loaded ones must hold their own type,
+//  after the first loop() only the failed one can not save
+static void boot(std::vector<uint32_t> types, std::vector<uint32_t> loaded, uint32_t failed)
+{
+  Device<fram::FRAM> fram(&bus, 32768);
+  Prefs prefs(&fram);
+  //  header 8 + 4 records of (8 dir + 16 data + 4 trailer)
+  prefs.set_pool(120, 0);
+  prefs.setup();
+
+  std::vector<ESPPreferenceObject> objs;
+  std::array<uint8_t, 16> data;
+  for (auto t : types)
+  {
+    objs.push_back(prefs.make_preference(16, t));
+    bool ok = objs.back().load(&data);
+    TEST_CHECK(ok == (std::find(loaded.begin(), loaded.end(), t) != loaded.end()));
+    if (ok) TEST_CHECK(data[0] == (uint8_t)t);
+
+    data.fill(t);
+    objs.back().save(&data);
+  }
+
+  prefs.run();
+  for (size_t i = 0; i < types.size(); i++)
+  {
+    data.fill(types[i]);
+    TEST_CHECK(objs[i].save(&data) == (types[i] != failed));
+  }
+}
+
+int main()
+{
+  boot({1, 2, 3, 4}, {}, 0);
+  boot({1, 2, 3, 4}, {1, 2, 3, 4}, 0);
+  //  5 first: the pool is full, 1..3 are requested after it and must survive
+  boot({5, 1, 2, 3}, {1, 2, 3}, 0);
+  boot({1, 2, 3, 5}, {1, 2, 3, 5}, 0);
+  //  all requested, nothing to reclaim
+  boot({6, 1, 2, 3, 5}, {1, 2, 3, 5}, 6);
+
+  puts("ok");
+  return 0;
+}
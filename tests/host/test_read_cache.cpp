@@ -0,0 +1,69 @@
+//  read cache, alone and with the write buffer, on all addressing types
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+template<class B> static void run(uint32_t size, uint8_t addrBytes, uint8_t pageBits, bool buffer)
+{
+  FakeBus bus(size, addrBytes, pageBits);
+  Device<B> fram(&bus, size);
+  fram.setMaxTransfer(24);
+  fram.setReadCache(16, 8);
+  if (buffer) fram.setWriteBuffer(128);
+
+  std::vector<uint8_t> model(bus.mem);
+  std::mt19937 rnd(2);
+  uint8_t buf[200];
+
+  for (int i = 0; i < 20000; i++)
+  {
+    uint32_t len = 1 + rnd() % 20;
+    uint32_t addr = rnd() % (size - 200);
+    //  no page crossings
+    addr = (addr & ~255UL) + (addr % (256 - len));
+    uint32_t op = rnd() % 10;
+
+    if (op < 4)
+    {
+      for (uint32_t k = 0; k < len; k++) model[addr + k] = buf[k] = rnd();
+      fram.write(addr, buf, len);
+    }
+    else if (op < 8)
+    {
+      fram.read(addr, buf, len);
+      TEST_CHECK(memcmp(buf, &model[addr], len) == 0);
+    }
+    else if (op == 8)
+    {
+      fram.fill(addr, len, 7);
+      memset(&model[addr], 7, len);
+    }
+    else
+    {
+      fram.flush();
+    }
+  }
+
+  fram.flush();
+  TEST_CHECK(bus.mem == model);
+  printf("%u bytes%s: hits %u, misses %u, %zu transactions\n", (unsigned)size,
+    buffer ? ", write buffer" : "", fram.getCacheHits(), fram.getCacheMisses(), bus.transactions);
+}
+
+int main()
+{
+  run<fram::FRAM>(32768, 2, 16, false);
+  run<fram::FRAM>(32768, 2, 16, true);
+  run<fram::FRAM11>(2048, 1, 8, false);
+  run<fram::FRAM11>(2048, 1, 8, true);
+  run<fram::FRAM32>(131072, 2, 16, false);
+  run<fram::FRAM32>(131072, 2, 16, true);
+
+  puts("ok");
+  return 0;
+}
@@ -0,0 +1,124 @@
+//  fram_ringbuffer against a queue model, fixed and variable records, with reloads
+#include "esphome/components/fram_ringbuffer/FRAM_RINGBUFFER.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <deque>
+#include <memory>
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+class RingBuffer : public fram_ringbuffer::FRAM_RINGBUFFER
+{
+public:
+  using FRAM_RINGBUFFER::FRAM_RINGBUFFER;
+  uint32_t saves() { return this->_saves; };
+};
+
+static void run(uint16_t recordSize)
+{
+  FakeBus bus(32768);
+  Device<fram::FRAM> fram(&bus, 32768);
+  std::deque<std::vector<uint8_t>> model;
+  std::mt19937 rnd(recordSize);
+
+  auto boot = [&]() {
+    auto rb = std::unique_ptr<RingBuffer>(new RingBuffer(&fram));
+    rb->setRegion(1000, 1000);
+    rb->setRecordSize(recordSize);
+    rb->setup();
+    return rb;
+  };
+  auto record = [&]() {
+    std::vector<uint8_t> rec(recordSize ? recordSize : rnd() % 40);
+    for (auto & c : rec) c = rnd();
+    return rec;
+  };
+
+  auto rb = boot();
+  for (int i = 0; i < 20000; i++)
+  {
+    uint32_t op = rnd() % 6;
+
+    if (op < 2)
+    {
+      auto rec = record();
+      if (rb->push(rec.data(), rec.size())) model.push_back(rec);
+      else TEST_CHECK(rb->full(rec.size()));
+    }
+    else if (op == 2)
+    {
+      //  variable records are packed with a 2 byte length
+      uint32_t cnt = 1 + rnd() % 8;
+      std::vector<uint8_t> packed;
+      std::vector<std::vector<uint8_t>> recs;
+      for (uint32_t k = 0; k < cnt; k++)
+      {
+        recs.push_back(record());
+        uint16_t len = recs.back().size();
+        if (!recordSize) packed.insert(packed.end(), {(uint8_t)(len & 0xFF), (uint8_t)(len >> 8)});
+        packed.insert(packed.end(), recs.back().begin(), recs.back().end());
+      }
+      if (rb->pushMany(packed.data(), cnt)) model.insert(model.end(), recs.begin(), recs.end());
+    }
+    else if (op == 3)
+    {
+      uint8_t buf[64];
+      int32_t len = rb->pop(buf, sizeof(buf));
+      if (model.empty())
+      {
+        TEST_CHECK(len == -1);
+      }
+      else
+      {
+        TEST_CHECK(len == (int32_t)model.front().size());
+        TEST_CHECK(memcmp(buf, model.front().data(), len) == 0);
+        model.pop_front();
+      }
+    }
+    else if (op == 4)
+    {
+      uint8_t buf[300];
+      uint32_t cnt = rb->popMany(buf, 1 + rnd() % 300);
+      uint32_t pos = 0;
+      for (uint32_t k = 0; k < cnt; k++)
+      {
+        auto & rec = model.front();
+        if (!recordSize)
+        {
+          uint16_t len;
+          memcpy(&len, buf + pos, 2);
+          TEST_CHECK(len == rec.size());
+          pos += 2;
+        }
+        TEST_CHECK(memcmp(buf + pos, rec.data(), rec.size()) == 0);
+        pos += rec.size();
+        model.pop_front();
+      }
+    }
+    else
+    {
+      //  power loss, the last saved state comes back, start over from empty
+      rb = boot();
+      model.clear();
+      uint8_t buf[64];
+      while (!rb->empty()) rb->pop(buf, sizeof(buf));
+      rb->save();
+    }
+
+    TEST_CHECK(rb->count() == model.size());
+  }
+
+  printf("record size %u: %u saves, %zu transactions\n", recordSize, rb->saves(), bus.transactions);
+}
+
+int main()
+{
+  run(0);
+  run(12);
+
+  puts("ok");
+  return 0;
+}
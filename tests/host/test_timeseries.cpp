@@ -0,0 +1,71 @@
+//  fram_timeseries: samples survive a reload and queries return them in order
+#include "esphome/components/fram_timeseries/FRAM_TIMESERIES.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <cmath>
+#include <memory>
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+int main()
+{
+  FakeBus bus(32768);
+  Device<fram::FRAM> fram(&bus, 32768);
+  fram.setMaxTransfer(126);
+
+  auto boot = [&]() {
+    auto ts = std::unique_ptr<fram_timeseries::FRAM_TIMESERIES>(new fram_timeseries::FRAM_TIMESERIES(&fram));
+    ts->setRegion(1000, 16384);
+    ts->setBlockSize(256);
+    ts->setup();
+    return ts;
+  };
+
+  auto ts = boot();
+  std::vector<std::pair<uint32_t, float>> model;
+  std::mt19937 rnd(16);
+  uint32_t time = 1700000000;
+  float value = 21.5f;
+
+  for (int i = 0; i < 20000; i++)
+  {
+    //  mostly regular, some jitter and a few long gaps
+    time += 10;
+    if (rnd() % 10 == 0) time += rnd() % 3 - 1;
+    if (rnd() % 500 == 0) time += 100000;
+    value = roundf((value + (int)(rnd() % 5 - 2) * 0.1f) * 10) / 10;
+
+    ts->add(time, value);
+    model.push_back({time, value});
+
+    if (i == 15000)
+    {
+      ts->flush();
+      ts = boot();
+    }
+  }
+
+  uint32_t samples = ts->getSamples();
+  printf("%u samples in %u blocks, %.2f bytes per sample, %zu bytes on the bus\n",
+    samples, ts->getBlocks(), 16384.0 / samples, bus.bytes);
+
+  //  the newest samples that fit
+  std::vector<std::pair<uint32_t, float>> out;
+  size_t first = model.size() - samples;
+  ts->query(0, 0xFFFFFFFF, [&](uint32_t t, float v) { out.push_back({t, v}); });
+  TEST_CHECK(out.size() == samples);
+  for (size_t k = 0; k < out.size(); k++) TEST_CHECK(out[k] == model[first + k]);
+
+  uint32_t from = model[first + 500].first;
+  uint32_t to = model[first + 700].first;
+  bus.transactions = 0;
+  uint32_t cnt = ts->query(from, to, [](uint32_t t, float v) {});
+  printf("range query of %u samples: %zu transactions\n", cnt, bus.transactions);
+  TEST_CHECK(cnt == 201);
+
+  puts("ok");
+  return 0;
+}
@@ -0,0 +1,108 @@
+//  readv()/writev() of scattered segments, with cache, buffer and gap threshold
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <algorithm>
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+template<class B> static void run(uint32_t size, uint8_t addrBytes, uint8_t pageBits, uint32_t mode, uint32_t seed)
+{
+  FakeBus bus(size, addrBytes, pageBits);
+  Device<B> fram(&bus, size);
+  fram.setMaxTransfer(1 + seed % 300);
+  fram.setGapThreshold(seed % 9);
+  if (mode & 1) fram.setReadCache(16, 8);
+  if (mode & 2) fram.setWriteBuffer(128);
+
+  std::vector<uint8_t> model(bus.mem);
+  std::mt19937 rnd(seed);
+  static uint8_t buf[16][64];
+
+  for (int i = 0; i < 2000; i++)
+  {
+    //  sorted, not overlapping, then shuffled
+    fram::FRAM_SEGMENT segs[16];
+    uint32_t cnt = 1 + rnd() % (size < 1024 ? 5 : 16);
+    uint32_t pos = rnd() % (size - cnt * 50);
+    for (uint32_t k = 0; k < cnt; k++)
+    {
+      pos += (rnd() % 3) ? 0 : rnd() % 10;
+      uint16_t len = rnd() % 40;
+      segs[k] = {pos, buf[k], len};
+      pos += len;
+    }
+    std::shuffle(segs, segs + cnt, rnd);
+
+    uint32_t op = rnd() % 10;
+    if (op < 4)
+    {
+      for (uint32_t k = 0; k < cnt; k++)
+      {
+        for (uint16_t j = 0; j < segs[k].size; j++) model[segs[k].memaddr + j] = segs[k].obj[j] = rnd();
+      }
+      fram.writev(segs, cnt);
+    }
+    else if (op < 9)
+    {
+      fram.readv(segs, cnt);
+      for (uint32_t k = 0; k < cnt; k++) TEST_CHECK(memcmp(segs[k].obj, &model[segs[k].memaddr], segs[k].size) == 0);
+    }
+    else
+    {
+      fram.flush();
+    }
+  }
+
+  fram.flush();
+  TEST_CHECK(bus.mem == model);
+}
+
+int main()
+{
+  for (uint32_t seed = 0; seed < 8; seed++)
+  {
+    for (uint32_t mode = 0; mode < 4; mode++)
+    {
+      run<fram::FRAM>(32768, 2, 16, mode, seed);
+      run<fram::FRAM11>(2048, 1, 8, mode, seed);
+      run<fram::FRAM9>(512, 1, 8, mode, seed);
+      run<fram::FRAM32>(131072, 2, 16, mode, seed);
+    }
+  }
+
+  //  8 fields of 4 bytes with a 3 byte hole: reads span it, writes must not
+  {
+    FakeBus bus(32768);
+    Device<fram::FRAM> fram(&bus, 32768);
+    fram.setMaxTransfer(126);
+    uint8_t data[8][4];
+    fram::FRAM_SEGMENT segs[8];
+    for (uint32_t k = 0; k < 8; k++) segs[k] = {100 + k * 4 + (k > 3) * 3, data[k], 4};
+
+    fram.writev(segs, 8);
+    printf("writev of 8 fields: %zu transactions\n", bus.transactions);
+    TEST_CHECK(bus.transactions == 2);
+    bus.transactions = 0;
+    fram.readv(segs, 8);
+    printf("readv of 8 fields: %zu transactions\n", bus.transactions);
+    TEST_CHECK(bus.transactions == 2);
+  }
+
+  //  FRAM11 segments across a page, the device address changes
+  {
+    FakeBus bus(2048, 1, 8);
+    Device<fram::FRAM11> fram(&bus, 2048);
+    uint8_t data[4][4];
+    fram::FRAM_SEGMENT segs[4] = {{250, data[0], 4}, {254, data[1], 4}, {258, data[2], 4}, {262, data[3], 4}};
+
+    fram.readv(segs, 4);
+    printf("FRAM11 readv across a page: %zu transactions\n", bus.transactions);
+  }
+
+  puts("ok");
+  return 0;
+}
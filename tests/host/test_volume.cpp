@@ -0,0 +1,44 @@
+//  fram_volume at its end: truncated and out of range transfers, reads past the end return zeros
+#include "esphome/components/fram_volume/FRAM_VOLUME.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <cstring>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+int main()
+{
+  FakeBus bus1(1024);
+  FakeBus bus2(1024);
+  Device<fram::FRAM> fram1(&bus1, 1024);
+  Device<fram::FRAM> fram2(&bus2, 1024);
+  fram_volume::FRAM_VOLUME volume;
+  volume.addMember(&fram1);
+  volume.addMember(&fram2);
+  volume.setup();
+  TEST_CHECK(volume.getSizeBytes() == 2048);
+
+  uint8_t buf[64];
+  for (uint32_t i = 0; i < sizeof(buf); i++) buf[i] = i + 1;
+  volume.write(2048 - 16, buf, sizeof(buf));
+  for (uint32_t i = 0; i < 16; i++) TEST_CHECK(bus2.mem[1024 - 16 + i] == i + 1);
+
+  //  the part in range is read, the rest is zero
+  memset(buf, 0xAA, sizeof(buf));
+  volume.read(2048 - 16, buf, sizeof(buf));
+  for (uint32_t i = 0; i < sizeof(buf); i++) TEST_CHECK(buf[i] == (i < 16 ? i + 1 : 0));
+
+  //  out of range, no bus traffic
+  size_t transactions = bus1.transactions + bus2.transactions;
+  memset(buf, 0xAA, sizeof(buf));
+  volume.read(2048, buf, sizeof(buf));
+  for (uint32_t i = 0; i < sizeof(buf); i++) TEST_CHECK(buf[i] == 0);
+  TEST_CHECK(volume.read32(5000) == 0);
+  volume.write32(2048, 0x12345678);
+  TEST_CHECK(bus1.transactions + bus2.transactions == transactions);
+
+  printf("volume end: %zu transactions\n", bus1.transactions + bus2.transactions);
+  return 0;
+}
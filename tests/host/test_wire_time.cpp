@@ -0,0 +1,53 @@
+//  wireTime() projection against the clock cycles counted on the fake bus
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+template<class B> static void run(uint32_t size, uint8_t addrBytes, uint8_t pageBits, uint16_t maxTransfer, uint32_t frequency)
+{
+  FakeBus bus(size, addrBytes, pageBits);
+  Device<B> fram(&bus, size);
+  fram.setMaxTransfer(maxTransfer);
+  fram.setBusFrequency(frequency);
+  uint8_t buf[1000];
+
+  for (uint32_t len : {1, 4, 23, 24, 25, 126, 127, 500, 1000})
+  {
+    //  wireTime() does not know the address, transfers also split at a device page
+    if (len > (1UL << (8 * addrBytes))) continue;
+
+    for (bool read : {true, false})
+    {
+      bus.bytes = bus.addressPhases = bus.cycles = 0;
+      fram.resetStats();
+      if (read) fram.read(0, buf, len);
+      else fram.write(0, buf, len);
+
+      uint32_t blocks = (len + maxTransfer - 1) / maxTransfer;
+      uint32_t projected = fram.wireTime(len, read);
+      uint32_t counted = bus.cycles * 1000000 / frequency;
+      printf("%s %4u bytes, max transfer %3u: %u address phases, %zu bytes, %u us projected, %u us counted\n",
+        read ? "read " : "write", (unsigned)len, maxTransfer, (unsigned)bus.addressPhases, bus.bytes, projected, counted);
+
+      TEST_CHECK(bus.addressPhases == blocks);
+      TEST_CHECK(bus.bytes == len + blocks * addrBytes);
+      TEST_CHECK(fram.getStats().wire_cycles == bus.cycles);
+      TEST_CHECK(projected == counted);
+    }
+  }
+}
+
+int main()
+{
+  run<fram::FRAM>(32768, 2, 16, 24, 100000);
+  run<fram::FRAM>(32768, 2, 16, 126, 400000);
+  run<fram::FRAM11>(2048, 1, 8, 126, 1000000);
+  run<fram::FRAM32>(131072, 2, 16, 254, 400000);
+
+  puts("ok");
+  return 0;
+}
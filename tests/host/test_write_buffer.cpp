@@ -0,0 +1,75 @@
+//  write buffer: random writes, reads and fills against a model of the memory
+#include "esphome/components/fram/FRAM.h"
+#include "fake_bus.h"
+#include "test.h"
+#include <random>
+
+using namespace esphome;
+using fram_test::Device;
+using fram_test::FakeBus;
+
+static void run(uint16_t buffer, uint16_t maxTransfer, uint32_t seed)
+{
+  FakeBus bus(32768);
+  Device<fram::FRAM> fram(&bus, 32768);
+  fram.setMaxTransfer(maxTransfer);
+  fram.setWriteBuffer(buffer);
+
+  std::vector<uint8_t> model(bus.mem);
+  std::mt19937 rnd(seed);
+  uint8_t buf[200];
+
+  for (int i = 0; i < 20000; i++)
+  {
+    uint32_t addr = rnd() % 2000;
+    uint32_t size = 1 + rnd() % 40;
+    uint32_t op = rnd() % 10;
+
+    if (op < 5)
+    {
+      for (uint32_t k = 0; k < size; k++) model[addr + k] = buf[k] = rnd();
+      fram.write(addr, buf, size);
+    }
+    else if (op < 8)
+    {
+      fram.read(addr, buf, size);
+      TEST_CHECK(memcmp(buf, &model[addr], size) == 0);
+    }
+    else if (op == 8)
+    {
+      fram.fill(addr, size * 5, 7);
+      memset(&model[addr], 7, size * 5);
+    }
+    else
+    {
+      fram.flush();
+    }
+  }
+
+  fram.flush();
+  TEST_CHECK(bus.mem == model);
+}
+
+int main()
+{
+  for (uint32_t seed = 0; seed < 4; seed++)
+  {
+    run(256, 126, seed);
+    run(256, 24, seed);
+    run(64, 126, seed);
+  }
+
+  //  adjacent small writes merge into few transactions
+  FakeBus bus(32768);
+  Device<fram::FRAM> fram(&bus, 32768);
+  fram.setMaxTransfer(126);
+  fram.setWriteBuffer(256);
+
+  for (uint32_t i = 0; i < 64; i++) fram.write32(100 + i * 4, i);
+  fram.flush();
+  printf("64 write32, 256 byte buffer: %zu transactions, %zu bytes\n", bus.transactions, bus.bytes);
+  TEST_CHECK(bus.transactions <= 3);
+
+  puts("ok");
+  return 0;
+}